@@ -2,14 +2,42 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <memory>
+#include <vector>
+#include <climits> // PATH_MAX
+#include <cstdlib> // realpath
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
+#include "mappedFile.hpp"   // From Demo&working-ish/src
+#include "requestBatch.hpp" // From Demo&working-ish/src
+#include "responseSink.hpp" // From Demo&working-ish/src
+#include "jsonPathExtractor.hpp" // From Demo&working-ish/src
+#include "bodyCompression.hpp" // From Demo&working-ish/src
+#include "bufferSync.hpp" // From Demo&working-ish/src
 
 class VSCodeAPIInteraction {
 private:
     std::string endpoint;
     std::string authType;
     std::string authToken;
+    // JSON pointers to keep from each reply; empty keeps the whole document
+    std::vector<std::string> responsePaths;
+    // Content-Encoding for large request bodies (API_COMPRESS unless set)
+    RequestCompression compression = RequestCompression::process();
+    // Upload files as deltas against what the endpoint already has
+    bool syncEnabled = false;
+
+    // {"<pointer>": value, ...} for every path that was present
+    nlohmann::json extractedJson(const JsonPathExtractor& extractor) const {
+        nlohmann::json picked = nlohmann::json::object();
+        for (size_t i = 0; i < responsePaths.size(); ++i) {
+            if (!extractor.found(i)) continue;
+            picked[responsePaths[i]] = extractor.isString(i)
+                ? nlohmann::json(extractor.value(i))
+                : nlohmann::json::parse(extractor.value(i));
+        }
+        return picked;
+    }
 
 public:
     VSCodeAPIInteraction(
@@ -21,6 +49,24 @@ public:
         authType(authentication), 
         authToken(token) {}
 
+    // Only these parts of each reply are kept; the rest is skipped while it
+    // is parsed instead of being built into a DOM and written back out
+    void setResponsePaths(const std::vector<std::string>& paths) {
+        responsePaths = paths;
+    }
+
+    // Files are compressed while they upload, so nothing extra is buffered
+    void setCompression(const RequestCompression& requestCompression) {
+        compression = requestCompression;
+    }
+
+    // With sync on, a file this endpoint has stored before goes out as only
+    // its changed chunks (see bufferSync.hpp); servers that don't support
+    // that still get the whole file
+    void setSync(bool enabled) {
+        syncEnabled = enabled;
+    }
+
     nlohmann::json sendAPIRequest(const std::string& payload) {
         cpr::Response response;
         cpr::Header headers = {
@@ -35,14 +81,24 @@ public:
         }
 
         try {
+            bool compress = compression.appliesTo(payload.size());
+            if (compress) {
+                headers["Content-Encoding"] = compression.contentEncoding();
+            }
             response = cpr::Post(
                 cpr::Url{endpoint},
-                cpr::Body{payload},
+                cpr::Body{compress ? compression.compress(payload) : payload},
                 headers
             );
 
             if (response.status_code == 200) {
-                return nlohmann::json::parse(response.text);
+                if (responsePaths.empty()) {
+                    return nlohmann::json::parse(response.text);
+                }
+                JsonPathExtractor extractor(responsePaths);
+                extractor.feed(response.text);
+                extractor.finish();
+                return extractedJson(extractor);
             } else {
                 throw std::runtime_error("API call failed: " + 
                     std::to_string(response.status_code));
@@ -53,34 +109,121 @@ public:
         }
     }
 
+    // Same as sendAPIRequest(), but the body is the file itself, mmap()ed and
+    // streamed to curl so it is never copied into a string
+    nlohmann::json sendAPIRequestFromFile(const std::string& filepath) {
+        try {
+            BatchRequest request;
+            request.url = endpoint;
+            request.headers.push_back("Content-Type: application/json");
+            if (authType == "bearer") {
+                request.headers.push_back("Authorization: Bearer " + authToken);
+            } else if (authType == "apikey") {
+                request.headers.push_back("X-API-Key: " + authToken);
+            }
+            request.body_file = std::make_shared<const MappedFile>(filepath);
+            request.compression = compression;
+
+            // With response paths the reply is parsed as it arrives
+            std::unique_ptr<JsonPathExtractor> extractor;
+            if (!responsePaths.empty()) {
+                extractor = std::make_unique<JsonPathExtractor>(responsePaths);
+                request.on_data = [&extractor](const char* data, size_t size) {
+                    extractor->feed(std::string_view(data, size));
+                };
+            }
+
+            static RequestBatch client(1);
+            BatchResult result;
+            if (syncEnabled) {
+                // The buffer is known by its absolute path
+                char resolved[PATH_MAX];
+                static BufferSync sync;
+                result = sync.send(client, request, realpath(filepath.c_str(), resolved) ? resolved : filepath);
+            } else {
+                result = client.run({request}).front();
+            }
+
+            if (!result.error.empty()) {
+                throw std::runtime_error(result.error);
+            }
+            if (result.status == 200) {
+                if (!extractor) {
+                    return nlohmann::json::parse(result.body);
+                }
+                extractor->finish();
+                return extractedJson(*extractor);
+            } else {
+                throw std::runtime_error("API call failed: " + 
+                    std::to_string(result.status));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return nlohmann::json{};
+        }
+    }
+
     // Read file content (simulating VS Code text editor)
     static std::string readFileContent(const std::string& filepath) {
-        std::ifstream file(filepath);
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return buffer.str();
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+        std::string content(file ? static_cast<size_t>(file.tellg()) : 0, '\0');
+        file.seekg(0);
+        file.read(&content[0], static_cast<std::streamsize>(content.size()));
+        return content;
     }
 
-    // Write response to file
-    void writeResponseToFile(const nlohmann::json& response) {
-        std::ofstream outputFile("/tmp/api_response.json");
-        outputFile << response.dump(4);
-        outputFile.close();
+    // Write response to file. With no path, every call gets its own
+    // /tmp/api_response.<pid>-<time>-<n>.json so concurrent runs never share
+    // one. The file appears atomically (temp file, fsync, rename). Returns
+    // the path written.
+    std::string writeResponseToFile(const nlohmann::json& response, const std::string& outputPath = "") {
+        std::string path = outputPath.empty()
+            ? ResponseSink::uniquePath(ResponseSink::tempDirectory() + "/api_response", ".json")
+            : outputPath;
+        ResponseSink sink(path);
+        std::string text = response.dump(4);
+        sink.write(text.data(), text.size());
+        sink.commit();
+        return path;
     }
 };
 
 // Command-line interface for testing
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
+    // Leading --path <json pointer> options (repeatable) keep only those
+    // parts of the reply; --compress gzip|zstd[:level] compresses the upload;
+    // --sync sends only what changed since the endpoint last stored the file
+    std::vector<std::string> responsePaths;
+    std::string compress;
+    bool sync = false;
+    int first = 1;
+    while (first < argc) {
+        std::string flag = argv[first];
+        if (flag == "--sync") {
+            sync = true;
+            first += 1;
+        } else if (flag == "--path" && first + 1 < argc) {
+            responsePaths.push_back(argv[first + 1]);
+            first += 2;
+        } else if (flag == "--compress" && first + 1 < argc) {
+            compress = argv[first + 1];
+            first += 2;
+        } else {
+            break;
+        }
+    }
+
+    if (argc - first < 2) {
         std::cerr << "Usage: " << argv[0] 
-                  << " <endpoint> <filepath> [auth_type] [auth_token]\n";
+                  << " [--path <json_pointer>]... [--compress gzip|zstd] [--sync] <endpoint> <filepath> [auth_type] [auth_token] [output_path]\n";
         return 1;
     }
 
-    std::string endpoint = argv[1];
-    std::string filepath = argv[2];
-    std::string authType = argc > 3 ? argv[3] : "none";
-    std::string authToken = argc > 4 ? argv[4] : "";
+    std::string endpoint = argv[first];
+    std::string filepath = argv[first + 1];
+    std::string authType = argc > first + 2 ? argv[first + 2] : "none";
+    std::string authToken = argc > first + 3 ? argv[first + 3] : "";
+    std::string outputPath = argc > first + 4 ? argv[first + 4] : "";
 
     try {
         VSCodeAPIInteraction apiInteraction(
@@ -88,17 +231,20 @@ int main(int argc, char* argv[]) {
             authType, 
             authToken
         );
+        apiInteraction.setResponsePaths(responsePaths);
+        apiInteraction.setSync(sync);
+        if (!compress.empty()) {
+            RequestCompression requested = RequestCompression::parse(compress);
+            requested.min_bytes = RequestCompression::process().min_bytes;
+            apiInteraction.setCompression(requested);
+        }
 
-        // Read file content
-        std::string payload = VSCodeAPIInteraction::readFileContent(filepath);
-
-        // Send API request
-        nlohmann::json response = apiInteraction.sendAPIRequest(payload);
-
-        // Write response to file
-        apiInteraction.writeResponseToFile(response);
+        // Send the file as the request body, streamed from a memory mapping
+        nlohmann::json response = apiInteraction.sendAPIRequestFromFile(filepath);
 
-       // std::cout << "API Response written to /tmp/api_response.json\n";
+        // Write response to file; the name is unique unless one was given,
+        // so print it for the caller (Vim) to pick up
+        std::cout << apiInteraction.writeResponseToFile(response, outputPath) << "\n";
         
         return 0;
     } catch (const std::exception& e) {
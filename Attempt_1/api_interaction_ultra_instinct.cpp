@@ -9,11 +9,24 @@
 #include <thread> // Sleep, nap, recover, try again.
 #include <regex> // For the regex sorcery you'd rather avoid.
 #include <filesystem> // Filesystem: the place where bugs hide.
+#include <algorithm> // std::find for plucking flags out of argv.
+#include <optional> // Maybe a cached answer, maybe not.
+#include <cctype> // isalnum for URL encoding.
+#include <type_traits> // is_same_v, for judging what a callable hands back.
 
 #include <cpr/cpr.h> // cpr: the HTTP library that actually helps you ship.
 #include <openssl/ssl.h> // For when things need to be encrypted and mysterious.
 #include <boost/algorithm/string.hpp> // Boost string tools because we like extra power.
 
+#include "responseCache.hpp" // Shared disk cache from Demo&working-ish/src (add it to your -I path).
+#include "requestBatch.hpp" // Same place: many requests, one curl multi handle.
+#include "retryPolicy.hpp" // Same place: when to try again and when to let it go.
+#include "mappedFile.hpp" // Same place: files as memory, minus the copying.
+#include "responseSink.hpp" // Same place: write as it arrives, publish atomically.
+#include "requestMetrics.hpp" // Same place: where the milliseconds went.
+#include "asyncLogger.hpp" // Same place: logs that never block and never touch stdout.
+#include "bodyCompression.hpp" // Same place: gzip/zstd for uploads that deserve it.
+
 // ---------------------------------------------------------------------------
 // THE LEGENDARY API HANDLER 9001
 // If this file could run on its own it'd probably refactor you back to life.
@@ -23,15 +36,16 @@ class APIInteractionLogger { // Logging class, tiny and powerful.
 public:
     enum class LogLevel { DEBUG, INFO, WARNING, ERROR }; // Severity levels, choose wisely.
 
+    // Legacy string-in entry point. New code uses API_LOG(Level, "event", {{"key", value}})
+    // so records are structured and compiled-out levels cost nothing; this one still
+    // goes through the same async queue to stderr, so stdout stays clean for the answer.
     static void log(LogLevel level, const std::string& message) { // Single-point logging convenience.
-        std::string levelStr; // Will become the human-readable prefix.
-        switch (level) { // Tiny switch to convert enum to string.
-            case LogLevel::DEBUG: levelStr = "DEBUG"; break; // Dev mode: spam it.
-            case LogLevel::INFO: levelStr = "INFO"; break; // Normal mode: useful info.
-            case LogLevel::WARNING: levelStr = "WARNING"; break; // Warning: things smell funny.
-            case LogLevel::ERROR: levelStr = "ERROR"; break; // Error: run for debug logs.
+        switch (level) { // Enum to AsyncLogger level, one hop.
+            case LogLevel::DEBUG: API_LOG(Debug, message); break; // Dev mode: elided in release.
+            case LogLevel::INFO: API_LOG(Info, message); break; // Normal mode: useful info.
+            case LogLevel::WARNING: API_LOG(Warning, message); break; // Warning: things smell funny.
+            case LogLevel::ERROR: API_LOG(Error, message); break; // Error: run for debug logs.
         }
-        std::cout << "[" << levelStr << "] " << message << std::endl; // Behold the single-line log.
     }
 }; // APIInteractionLogger: concise, savage, informative.
 
@@ -81,8 +95,10 @@ private:
     std::map<std::string, std::string> headers; // Headers to send with dignity.
     std::map<std::string, std::string> queryParams; // Query params in the URL.
     std::string body; // Body payload, the main message in a bottle.
+    std::shared_ptr<const MappedFile> bodyFile; // Or a mapped file, streamed without a single copy.
     std::string authType; // "bearer" or "apikey" or "sorcery".
     std::string authToken; // Token string, hopefully not "changeme".
+    RequestCompression compression = RequestCompression::process(); // API_COMPRESS says whether big bodies get squeezed.
 
 public:
     APIRequestBuilder(const std::string& url) // Construct with URL, defaults to POST.
@@ -105,9 +121,21 @@ public:
 
     APIRequestBuilder& setBody(const std::string& requestBody) { // Set the request body.
         body = requestBody; // Copy in the body (maybe big).
+        bodyFile.reset(); // Last setter wins.
         return *this; // For chaining until infinity.
     }
 
+    APIRequestBuilder& setBodyFile(std::shared_ptr<const MappedFile> file) { // Big bodies: stream, don't copy.
+        bodyFile = std::move(file); // Shared, so copies of this builder don't remap.
+        body.clear(); // Last setter wins.
+        return *this; // Chain on.
+    }
+
+    APIRequestBuilder& setCompression(const RequestCompression& requestCompression) { // gzip, zstd, or none.
+        compression = requestCompression; // Only kicks in past the size threshold.
+        return *this; // Chain, compressed.
+    }
+
     APIRequestBuilder& setAuthentication(const std::string& type, const std::string& token) { // Add auth header.
         authType = type; // e.g., "bearer"
         authToken = token; // the secret stuff
@@ -121,6 +149,14 @@ public:
     }
 
     cpr::Response execute() { // Execute the constructed request; pray if necessary.
+        if (bodyFile && (method == "POST" || method == "PUT")) { // cpr would copy the body; raw curl streams it from the mapping.
+            RetryPolicy once; // Callers wrap us in RetryStrategy already, so no retries down here.
+            once.max_attempts = 1; // One shot.
+            static RequestBatch uploader(1, once); // Kept warm so the connection survives between calls.
+            std::vector<BatchRequest> one{toBatchRequest()}; // A batch of one.
+            return toResponses(one, uploader.run(one)).front(); // Fire and unwrap.
+        }
+
         cpr::Header cprHeaders; // CPR's header container.
         for (const auto& kv : headers) { // Convert our map to CPR headers.
             cprHeaders[kv.first] = kv.second; // Assign each header entry.
@@ -131,17 +167,96 @@ public:
             cprParams.Add({kv.first, kv.second}); // Magical Add call — make sure your CPR version supports it.
         }
 
+        bool squeeze = (method == "POST" || method == "PUT") && compression.appliesTo(body.size()); // Worth compressing?
+        if (squeeze) cprHeaders["Content-Encoding"] = compression.contentEncoding(); // Tell the server how to unsqueeze.
+        std::string squeezed = squeeze ? compression.compress(body) : std::string(); // The compressed twin, if any.
+        const std::string& wireBody = squeeze ? squeezed : body; // What actually gets sent; no copies either way.
+
+        cpr::Response response; // Whatever the server decides to say.
         if (method == "POST") { // Handle POST requests.
-            return cpr::Post(cpr::Url{endpoint}, cpr::Body{body}, cprHeaders, cprParams); // Send POST.
+            response = cpr::Post(cpr::Url{endpoint}, cpr::Body{wireBody}, cprHeaders, cprParams); // Send POST.
         } else if (method == "GET") { // Handle GET requests.
-            return cpr::Get(cpr::Url{endpoint}, cprHeaders, cprParams); // Send GET.
+            response = cpr::Get(cpr::Url{endpoint}, cprHeaders, cprParams); // Send GET.
         } else if (method == "PUT") { // Handle PUT requests.
-            return cpr::Put(cpr::Url{endpoint}, cpr::Body{body}, cprHeaders, cprParams); // Send PUT.
+            response = cpr::Put(cpr::Url{endpoint}, cpr::Body{wireBody}, cprHeaders, cprParams); // Send PUT.
         } else if (method == "DELETE") { // Handle DELETE requests.
-            return cpr::Delete(cpr::Url{endpoint}, cprHeaders, cprParams); // Send DELETE.
+            response = cpr::Delete(cpr::Url{endpoint}, cprHeaders, cprParams); // Send DELETE.
+        } else {
+            throw std::runtime_error("Unsupported HTTP method — the universe hates this request."); // Fatal if unsupported.
+        }
+
+        RequestSample sample; // cpr only tells us the total, so that's all the phases we get.
+        sample.endpoint = RequestSample::stripQuery(endpoint); // Keys stay out of the metrics.
+        sample.status = response.status_code; // 0 when the transfer itself died.
+        sample.error = response.status_code == 0 || response.status_code >= 400; // Judged harshly.
+        sample.bytes_in = (int64_t)response.text.size(); // What came back.
+        sample.bytes_out = (int64_t)wireBody.size(); // What actually went over the wire.
+        sample.total_us = (int64_t)(response.elapsed * 1e6); // Seconds to microseconds.
+        RequestMetrics::process().record(sample); // Into the histograms it goes.
+        return response; // Hand it back, untouched.
+    }
+
+    cpr::Response executeToSink(ResponseSink& sink) { // Execute, but the body goes to the sink as it arrives.
+        RetryPolicy once; // Same deal as execute(): RetryStrategy owns the retries.
+        once.max_attempts = 1; // One shot.
+        static RequestBatch streamer(1, once); // Warm connection, kept between calls.
+        std::vector<BatchRequest> one{toBatchRequest()}; // A batch of one...
+        one.front().sink = &sink; // ...pointed at the sink instead of a string.
+        return toResponses(one, streamer.run(one)).front(); // text stays empty; the bytes are in the sink.
+    }
+
+    BatchRequest toBatchRequest() const { // Flatten into something RequestBatch can fire.
+        BatchRequest request; // The plain-data twin of this builder.
+        request.url = endpoint; // Start from the bare endpoint.
+        char separator = endpoint.find('?') == std::string::npos ? '?' : '&'; // Respect any existing query.
+        for (const auto& kv : queryParams) { // cpr did the encoding for us; now it's our job.
+            request.url += separator + percentEncode(kv.first) + "=" + percentEncode(kv.second);
+            separator = '&'; // Only the first one gets the question mark.
         }
+        request.method = method; // GET, POST, whatever you fancy.
+        for (const auto& kv : headers) request.headers.push_back(kv.first + ": " + kv.second); // "Name: value" lines.
+        request.body = body; // The message in the bottle.
+        request.body_file = bodyFile; // Or the mapped file, if that's what we have.
+        request.compression = compression; // Files get squeezed on the fly as they upload.
+        return request; // Ready for the firing squad.
+    }
+
+    // Fire a whole pile of builders concurrently; answers come back in the same order.
+    static std::vector<cpr::Response> executeBatch(const std::vector<APIRequestBuilder>& builders,
+                                                   size_t maxConcurrency = 8) {
+        std::vector<BatchRequest> requests; // Flattened requests.
+        for (const auto& builder : builders) requests.push_back(builder.toBatchRequest()); // Flatten them all.
 
-        throw std::runtime_error("Unsupported HTTP method — the universe hates this request."); // Fatal if unsupported.
+        RequestBatch batch(maxConcurrency); // One multi handle, many streams.
+        return toResponses(requests, batch.run(requests)); // The big fan-out, same order you asked in. Always.
+    }
+
+private:
+    static std::vector<cpr::Response> toResponses(const std::vector<BatchRequest>& requests,
+                                                  std::vector<BatchResult> results) { // Dress results up as cpr responses.
+        std::vector<cpr::Response> responses(results.size()); // One per result.
+        for (size_t i = 0; i < results.size(); ++i) {
+            responses[i].status_code = results[i].status; // 0 means the transfer itself died.
+            responses[i].text = std::move(results[i].body); // The goods.
+            responses[i].url = cpr::Url{requests[i].url}; // Where it came from.
+            responses[i].error.message = results[i].error; // Why it died, if it did.
+        }
+        return responses; // Indistinguishable from the real thing (mostly).
+    }
+
+    static std::string percentEncode(const std::string& value) { // URL-encode like it's RFC 3986.
+        static const char* hex = "0123456789ABCDEF"; // Hex digits, the classics.
+        std::string encoded; // Output buffer.
+        for (unsigned char c : value) { // Byte by byte.
+            if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                encoded += (char)c; // Unreserved: pass through.
+            } else {
+                encoded += '%'; // Everything else gets the percent treatment.
+                encoded += hex[c >> 4];
+                encoded += hex[c & 15];
+            }
+        }
+        return encoded; // Safe for any URL.
     }
 }; // APIRequestBuilder: small, mighty, opinionated.
 
@@ -154,29 +269,38 @@ class APIResponseHandler { // Convert responses into files and status messages.
 public:
     enum class ResponseFormat { JSON, XML, PLAIN, BINARY }; // Output formats we care about.
 
-    static void processResponse(const cpr::Response& response,
-                                ResponseFormat format = ResponseFormat::JSON,
-                                const std::string& outputPath = "/tmp/api_response") { // Save response appropriately.
-        if (response.status_code != 200) { // If it's not 200, something is wrong.
-            APIInteractionLogger::log(APIInteractionLogger::LogLevel::ERROR, // Log the error.
-                                      "API Request Failed: " + std::to_string(response.status_code)); // Make noise.
-            throw std::runtime_error("API request failed — inspect logs, consult ritual."); // Throw to caller.
+    static std::string extensionFor(ResponseFormat format) { // Determine extension by format.
+        switch (format) {
+            case ResponseFormat::JSON: return ".json"; // JSON extension.
+            case ResponseFormat::XML: return ".xml"; // XML extension.
+            case ResponseFormat::PLAIN: return ".txt"; // Plain text.
+            case ResponseFormat::BINARY: return ".bin"; // Binary payload.
         }
+        return ""; // Unreachable, but compilers worry.
+    }
 
-        std::filesystem::path outputFile; // The file path we'll write to.
-        switch (format) { // Determine extension by format.
-            case ResponseFormat::JSON: outputFile = outputPath + ".json"; break; // JSON extension.
-            case ResponseFormat::XML: outputFile = outputPath + ".xml"; break; // XML extension.
-            case ResponseFormat::PLAIN: outputFile = outputPath + ".txt"; break; // Plain text.
-            case ResponseFormat::BINARY: outputFile = outputPath + ".bin"; break; // Binary payload.
+    // Where to save: the caller's path plus extension, or a fresh unique name so
+    // concurrent runs never trample each other's output.
+    static std::string outputFileFor(const std::string& outputPath, ResponseFormat format) {
+        std::string prefix = outputPath.empty() ? ResponseSink::tempDirectory() + "/api_response" : outputPath; // Default home.
+        return outputPath.empty() ? ResponseSink::uniquePath(prefix, extensionFor(format)) // One name per request.
+                                  : prefix + extensionFor(format); // Caller knows best.
+    }
+
+    static std::string processResponse(const cpr::Response& response,
+                                       ResponseFormat format = ResponseFormat::JSON,
+                                       const std::string& outputPath = "") { // Save response appropriately; returns where.
+        if (response.status_code != 200) { // If it's not 200, something is wrong.
+            API_LOG(Error, "api.request_failed", {{"status", response.status_code}}); // Make noise.
+            throw std::runtime_error("API request failed — inspect logs, consult ritual."); // Throw to caller.
         }
 
-        std::ofstream outFile(outputFile, std::ios::binary); // Open output file stream.
-        outFile << response.text; // Dump response text into it like confetti.
-        outFile.close(); // Close the file and celebrate.
+        ResponseSink sink(outputFileFor(outputPath, format)); // Temp file beside the target.
+        sink.write(response.text.data(), response.text.size()); // Dump response text into it like confetti.
+        sink.commit(); // fsync + rename: readers never see half a file.
 
-        APIInteractionLogger::log(APIInteractionLogger::LogLevel::INFO, // Inform the world.
-                                  "Response saved to: " + outputFile.string()); // Where to find the treasure.
+        API_LOG(Info, "api.response_saved", {{"path", sink.path()}}); // Where to find the treasure.
+        return sink.path(); // So the caller can find it too.
     }
 }; // APIResponseHandler: part archivist, part hype-man.
 
@@ -187,29 +311,43 @@ public:
 
 class RetryStrategy { // Retry wrapper to tame flaky endpoints.
 private:
-    int maxRetries; // How many times to try before rage-quitting.
-    std::chrono::milliseconds delay; // Initial delay between tries.
+    RetryPolicy policy; // Jittered, capped, budgeted — the shared rulebook from retryPolicy.hpp.
 
 public:
-    RetryStrategy(int retries = 3, int delayMs = 1000) // Default: 3 retries, 1 second initial delay.
-        : maxRetries(retries), delay(delayMs) {} // Initialize members.
+    RetryStrategy(int retries = 3, int delayMs = 1000) { // Default: 3 attempts, 1 second base delay.
+        policy.max_attempts = retries; // How many times to try before rage-quitting.
+        policy.base_delay = std::chrono::milliseconds(delayMs); // Ceiling of the first jittered wait.
+    }
 
+    // Blocking flavor for one request at a time. Batches get the same rules without
+    // the sleeping: RequestBatch parks backing-off requests on a timer instead.
     template<typename Func>
     auto executeWithRetry(Func&& apiCall) { // Execute a callable with retry semantics.
-        for (int attempt = 0; attempt < maxRetries; ++attempt) { // Loop up to maxRetries.
+        RetryBudget::process().recordAttempt(); // Every first try earns a sliver of retry budget.
+        for (int attempt = 1; ; ++attempt) { // Loop until success, a final answer, or policy says stop.
+            std::chrono::milliseconds delay{0}; // How long to nap before the next go.
             try {
-                return apiCall(); // If it works, return immediately.
+                auto result = apiCall(); // Give it a shot.
+                if constexpr (std::is_same_v<std::decay_t<decltype(result)>, cpr::Response>) { // HTTP answers get judged.
+                    auto retryAfter = result.header.find("Retry-After"); // Did the server tell us when to come back?
+                    CURLcode transport = result.status_code == 0 ? CURLE_RECV_ERROR : CURLE_OK; // 0 = never got an answer.
+                    if (!policy.shouldRetry(attempt, result.status_code, transport,
+                                            retryAfter == result.header.end() ? "" : retryAfter->second, delay)) {
+                        return result; // Success, a 4xx verdict, or out of tries/budget: caller decides.
+                    }
+                    API_LOG(Warning, "api.retry", {{"attempt", attempt}, {"status", result.status_code},
+                                                   {"delay_ms", (int64_t)delay.count()}}); // Log the retry.
+                } else {
+                    return result; // Not an HTTP response; nothing to judge.
+                }
             } catch (const std::exception& e) { // If it throws, handle.
-                if (attempt == maxRetries - 1) throw; // Last attempt: rethrow for caller to handle.
+                if (!policy.shouldRetry(attempt, 0, CURLE_RECV_ERROR, "", delay)) throw; // Out of chances: rethrow.
 
-                APIInteractionLogger::log(APIInteractionLogger::LogLevel::WARNING, // Log the retry.
-                                          "Attempt " + std::to_string(attempt + 1) +
-                                          " failed. Retrying in " + std::to_string(delay.count()) + "ms");
-                std::this_thread::sleep_for(delay); // Sleep for the delay.
-                delay *= 2; // Exponential backoff because servers like drama.
+                API_LOG(Warning, "api.retry", {{"attempt", attempt}, {"error", e.what()},
+                                               {"delay_ms", (int64_t)delay.count()}}); // Log the retry.
             }
+            std::this_thread::sleep_for(delay); // Jittered nap so we don't stampede with everyone else.
         }
-        throw std::runtime_error("Max retries exceeded — the API wins this round."); // If loop finishes oddly.
     }
 }; // RetryStrategy: patient, persistent, slightly smug.
 
@@ -221,12 +359,17 @@ public:
 class FileContentReader { // Read files into strings and write strings to files.
 public:
     static std::string readFile(const std::string& filepath) { // Read entire file as string.
-        std::ifstream file(filepath, std::ios::binary); // Binary mode to preserve bytes.
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate); // Binary mode, start at the end to learn the size.
         if (!file) throw std::runtime_error("Cannot open file: " + filepath); // Error if missing.
 
-        std::stringstream buffer; // Buffer to accumulate file contents.
-        buffer << file.rdbuf(); // Stream file into buffer.
-        return buffer.str(); // Return the glorious content.
+        std::string content(static_cast<size_t>(file.tellg()), '\0'); // Allocate once, exactly.
+        file.seekg(0); // Back to the start.
+        file.read(&content[0], static_cast<std::streamsize>(content.size())); // Straight into the string, no stringstream detour.
+        return content; // Return the glorious content.
+    }
+
+    static std::shared_ptr<const MappedFile> mapFile(const std::string& filepath) { // Map instead of read: zero copies.
+        return std::make_shared<const MappedFile>(filepath); // Throws "Cannot open file" just like readFile.
     }
 
     static void writeFile(const std::string& filepath, const std::string& content) { // Write string to file.
@@ -245,31 +388,141 @@ class APIInteractionManager { // Higher-level API orchestration.
 private:
     APICredentialManager credentialManager; // Manages tokens.
     RetryStrategy retryStrategy; // Handles retries.
+    ResponseCache responseCache; // Disk cache: the fastest request is the one never sent.
+    bool cacheEnabled = true; // Flip off to force a trip to the network.
+
+    static bool isCacheable(const std::string& method) { // Only replay methods that don't change the world.
+        return method == "GET" || method == "POST"; // POST counts: LLM prompts are questions, not orders.
+    }
+
+    std::optional<std::string> timedLookup(const ResponseCache::Key& key, const std::string& endpoint) { // Lookup that counts as a request.
+        auto started = std::chrono::steady_clock::now(); // Start the stopwatch.
+        auto cached = responseCache.lookup(key); // Ask the disk.
+        if (cached) { // Hits go in the metrics as (very fast) requests.
+            RequestMetrics::process().record(RequestSample::cacheHit(
+                endpoint, std::chrono::steady_clock::now() - started, cached->size()));
+        }
+        return cached; // Hit or miss, the caller decides.
+    }
+
+    std::optional<std::string> cachedResponse(const ResponseCache::Key& key, const std::string& endpoint,
+                                              const std::string& method,
+                                              APIResponseHandler::ResponseFormat format) { // Answer from disk if we can.
+        if (!cacheEnabled || !isCacheable(method)) return std::nullopt; // Bypassed or unsafe to replay.
+        auto cached = timedLookup(key, endpoint); // Ask the disk nicely.
+        if (!cached) return std::nullopt; // Miss: off to the network we go.
+
+        cpr::Response replay; // Dress the cached body up as a real response.
+        replay.status_code = 200; // Only successes ever get cached.
+        replay.text = *cached; // The body, straight from disk.
+        APIResponseHandler::processResponse(replay, format); // Same output file as a live call.
+        API_LOG(Debug, "cache.hit", {{"key", key.hex()}}); // Brag quietly (and not at all in release builds).
+        return cached; // Microseconds instead of seconds.
+    }
 
 public:
+    APIInteractionManager& setCacheEnabled(bool enabled) { // The bypass switch.
+        cacheEnabled = enabled; // Obey.
+        return *this; // Chainable, naturally.
+    }
+
     std::string performAPIInteraction(const std::string& endpoint,
                                       const std::string& inputFilePath,
                                       const std::string& apiName = "default",
                                       const std::string& method = "POST") { // Simple interaction wrapper.
         try {
-            std::string payload = FileContentReader::readFile(inputFilePath); // Read payload from file.
+            auto payload = FileContentReader::mapFile(inputFilePath); // Map payload, don't copy it.
             std::string authType = "bearer"; // Default auth type for modern times.
             std::string authToken = credentialManager.getCredential(apiName + "_token"); // Retrieve token.
 
+            auto cacheKey = ResponseCache::makeKey(endpoint, method, // Everything that shapes the answer...
+                                                   {{"Content-Type", "application/json"}, {"Auth-Type", authType}},
+                                                   payload->view()); // ...but never the token itself.
+            if (auto cached = cachedResponse(cacheKey, endpoint, method, APIResponseHandler::ResponseFormat::JSON)) {
+                return *cached; // Served from disk, no quota spent.
+            }
+
             auto apiResponse = retryStrategy.executeWithRetry([&]() { // Execute with retry semantics.
                 return APIRequestBuilder(endpoint) // Build the request in one gorgeous chain.
                     .setMethod(method) // Set HTTP method.
                     .addHeader("Content-Type", "application/json") // Set content type, because JSON is life.
                     .setAuthentication(authType, authToken) // Set authentication headers.
-                    .setBody(payload) // Attach body payload.
+                    .setBodyFile(payload) // Attach body payload, streamed from the mapping.
                     .execute(); // Fire it off like confetti.
             });
 
             APIResponseHandler::processResponse(apiResponse, APIResponseHandler::ResponseFormat::JSON); // Save result.
+            if (cacheEnabled && isCacheable(method)) responseCache.store(cacheKey, apiResponse.text); // Remember it.
             return apiResponse.text; // Return the body to caller.
         } catch (const std::exception& e) { // Catch and log anything that went sideways.
-            APIInteractionLogger::log(APIInteractionLogger::LogLevel::ERROR,
-                                      std::string("API Interaction Failed: ") + e.what()); // Scream into the logs.
+            API_LOG(Error, "api.interaction_failed", {{"endpoint", endpoint}, {"error", e.what()}}); // Scream into the logs.
+            throw; // Re-throw for caller to decide penalty.
+        }
+    }
+
+    // Like performAPIInteraction, but the response streams straight into outputPath
+    // (or a unique temp name, or stdout for "-") and is never held in memory.
+    // Returns the path written, or "-" for stdout.
+    std::string downloadAPIInteraction(const std::string& endpoint,
+                                       const std::string& inputFilePath,
+                                       const std::string& apiName = "default",
+                                       const std::string& method = "POST",
+                                       const std::string& outputPath = "",
+                                       APIResponseHandler::ResponseFormat format = APIResponseHandler::ResponseFormat::JSON) {
+        try {
+            auto payload = FileContentReader::mapFile(inputFilePath); // Map payload, don't copy it.
+            std::string authType = "bearer"; // Same defaults as performAPIInteraction.
+            std::string authToken = credentialManager.getCredential(apiName + "_token"); // Retrieve token.
+            bool toStdout = outputPath == "-"; // Pipe mode: the reader starts before we finish.
+
+            auto cacheKey = ResponseCache::makeKey(endpoint, method, // Same key as performAPIInteraction.
+                                                   {{"Content-Type", "application/json"}, {"Auth-Type", authType}},
+                                                   payload->view());
+            bool useCache = cacheEnabled && isCacheable(method); // Decide once.
+            if (useCache) {
+                if (auto cached = timedLookup(cacheKey, endpoint)) { // Already have it?
+                    if (toStdout) {
+                        ResponseSink(STDOUT_FILENO).write(cached->data(), cached->size()); // Straight out.
+                        return "-";
+                    }
+                    cpr::Response replay; // Dress it up like a live answer.
+                    replay.status_code = 200;
+                    replay.text = std::move(*cached);
+                    return APIResponseHandler::processResponse(replay, format, outputPath); // Atomic save.
+                }
+            }
+
+            std::optional<ResponseSink> sink; // Built per mode below.
+            if (toStdout) sink.emplace(STDOUT_FILENO); // Caller-supplied descriptor.
+            else sink.emplace(APIResponseHandler::outputFileFor(outputPath, format)); // Temp file beside the target.
+
+            auto apiResponse = retryStrategy.executeWithRetry([&]() { // Execute with retry semantics.
+                if (!sink->rewind()) { // Retrying into a pipe we already wrote to would corrupt it.
+                    throw std::runtime_error("Cannot retry: part of the response was already streamed out");
+                }
+                return APIRequestBuilder(endpoint) // Build the request in one gorgeous chain.
+                    .setMethod(method)
+                    .addHeader("Content-Type", "application/json")
+                    .setAuthentication(authType, authToken)
+                    .setBodyFile(payload)
+                    .executeToSink(*sink); // Bytes hit the disk as they arrive.
+            });
+
+            if (apiResponse.status_code != 200) { // Same verdict as processResponse.
+                API_LOG(Error, "api.request_failed", {{"status", apiResponse.status_code}});
+                throw std::runtime_error("API request failed — inspect logs, consult ritual."); // Temp file is removed on the way out.
+            }
+            if (toStdout) return "-"; // Already delivered.
+
+            sink->commit(); // fsync + rename into place.
+            if (useCache) { // Cache straight from the committed file, no heap copy.
+                MappedFile saved(sink->path());
+                responseCache.store(cacheKey, saved.view());
+            }
+            API_LOG(Info, "api.response_saved", {{"path", sink->path()}});
+            return sink->path(); // Treasure map.
+        } catch (const std::exception& e) { // Catch and log anything that went sideways.
+            API_LOG(Error, "api.download_failed", {{"endpoint", endpoint}, {"error", e.what()}});
             throw; // Re-throw for caller to decide penalty.
         }
     }
@@ -281,22 +534,30 @@ public:
                                        const std::string& method = "POST",
                                        APIResponseHandler::ResponseFormat responseFormat = APIResponseHandler::ResponseFormat::JSON) { // More options.
         try {
-            std::string payload = FileContentReader::readFile(inputFilePath); // Read input file payload.
+            auto payload = FileContentReader::mapFile(inputFilePath); // Map input file payload.
             auto requestBuilder = APIRequestBuilder(endpoint) // Start building the request.
                 .setMethod(method) // Set HTTP method upfront.
                 .addHeader("Content-Type", "application/json") // Default header, humble but effective.
-                .setBody(payload); // Place the payload where it needs to be.
+                .setBodyFile(payload); // Place the payload where it needs to be.
 
             for (const auto& kv : customHeaders) requestBuilder.addHeader(kv.first, kv.second); // Add extra headers like it's 2005.
             for (const auto& kv : queryParams) requestBuilder.addQueryParam(kv.first, kv.second); // Add query params for the pedants.
 
+            std::vector<std::pair<std::string, std::string>> keyHeaders(customHeaders.begin(), customHeaders.end()); // Custom headers shape the answer.
+            std::string keyEndpoint = endpoint; // Query params too, so fold them into the URL.
+            for (const auto& kv : queryParams) keyEndpoint += "&" + kv.first + "=" + kv.second; // std::map keeps them sorted.
+            auto cacheKey = ResponseCache::makeKey(keyEndpoint, method, keyHeaders, payload->view()); // One key to find them all.
+            if (auto cached = cachedResponse(cacheKey, endpoint, method, responseFormat)) {
+                return *cached; // Disk wins again.
+            }
+
             auto apiResponse = retryStrategy.executeWithRetry([&]() { return requestBuilder.execute(); }); // Execute with retries.
 
             APIResponseHandler::processResponse(apiResponse, responseFormat); // Save and log the response.
+            if (cacheEnabled && isCacheable(method)) responseCache.store(cacheKey, apiResponse.text); // Save for next time.
             return apiResponse.text; // Return response body to caller.
         } catch (const std::exception& e) { // If something breaks, log and rethrow.
-            APIInteractionLogger::log(APIInteractionLogger::LogLevel::ERROR,
-                                      std::string("Advanced API Interaction Failed: ") + e.what()); // Log the defeat.
+            API_LOG(Error, "api.advanced_interaction_failed", {{"endpoint", endpoint}, {"error", e.what()}}); // Log the defeat.
             throw; // Let caller handle the sorrow.
         }
     }
@@ -306,57 +567,69 @@ public:
 // main()
 // The final frontier — where parameters meet destiny.
 // Usage example:
-//    ./api_overlord <endpoint> <input_file> <method> [api_name] [output_path]
+//    ./api_overlord [--no-cache] [--stats] [--compress gzip|zstd] <endpoint> <input_file> <method> [api_name] [output_path]
+// output_path defaults to a unique /tmp/api_response.<pid>-<time>-<n>.json; "-" streams to stdout.
 // Example:
 //    ./api_overlord "https://postman-echo.com/post" "payload.json" "POST" "default" "/tmp/output"
 // ---------------------------------------------------------------------------
 
 int main(int argc, char* argv[]) { // The chosen one: main.
+    bool showStats = false; // --stats: print where the time went, win or lose.
     try {
+        // Pluck out flags first so the positional args stay positional.
+        std::vector<std::string> args(argv, argv + argc); // argv, but civilized.
+        auto noCache = std::find(args.begin(), args.end(), "--no-cache"); // Did they ask for fresh data?
+        bool useCache = noCache == args.end(); // Cache on unless told otherwise.
+        if (!useCache) args.erase(noCache); // Remove the flag from the lineup.
+        auto statsFlag = std::find(args.begin(), args.end(), "--stats"); // Want the receipts?
+        showStats = statsFlag != args.end(); // Timing histograms on exit.
+        if (showStats) args.erase(statsFlag); // Same eviction policy.
+        auto compressFlag = std::find(args.begin(), args.end(), "--compress"); // gzip|zstd[:level] for the upload.
+        if (compressFlag != args.end() && compressFlag + 1 != args.end()) {
+            size_t minBytes = RequestCompression::process().min_bytes; // Keep API_COMPRESS_MIN_BYTES.
+            RequestCompression::process() = RequestCompression::parse(*(compressFlag + 1)); // Every builder picks it up.
+            RequestCompression::process().min_bytes = minBytes;
+            args.erase(compressFlag, compressFlag + 2); // Flag and value, gone together.
+        }
+        argc = (int)args.size(); // Recount the survivors.
+
         // Check for required parameters like a bouncer at a code club.
         if (argc < 4) {
-            std::cerr << "Usage: " << argv[0]
-                      << " <endpoint> <input_file> <method> [api_name] [output_path]\n";
-            std::cerr << "Example: " << argv[0]
+            std::cerr << "Usage: " << args[0]
+                      << " [--no-cache] [--stats] [--compress gzip|zstd] <endpoint> <input_file> <method> [api_name] [output_path]\n";
+            std::cerr << "Example: " << args[0]
                       << " \"https://postman-echo.com/post\" payload.json POST\n";
             return 1; // Early exit before the chaos begins.
         }
 
         // Grab CLI arguments because hardcoding is for mortals.
-        std::string endpoint = argv[1];       // The API endpoint.
-        std::string inputFile = argv[2];      // JSON or whatever you’re sending.
-        std::string method = argv[3];         // GET, POST, PUT, DELETE, etc.
-        std::string apiName = (argc > 4) ? argv[4] : "default"; // Optional API name for credentials.
-        std::string outputPath = (argc > 5) ? argv[5] : "/tmp/api_response"; // Optional output path.
+        std::string endpoint = args[1];       // The API endpoint.
+        std::string inputFile = args[2];      // JSON or whatever you’re sending.
+        std::string method = args[3];         // GET, POST, PUT, DELETE, etc.
+        std::string apiName = (argc > 4) ? args[4] : "default"; // Optional API name for credentials.
+        std::string outputPath = (argc > 5) ? args[5] : ""; // Optional output path; empty = unique temp name.
 
         // Log that we’re about to do something heroic.
-        APIInteractionLogger::log(APIInteractionLogger::LogLevel::INFO,
-            "Starting API call to: " + endpoint + " using " + method);
+        API_LOG(Info, "api.start", {{"endpoint", RequestSample::stripQuery(endpoint)}, {"method", method}});
 
         // Construct the all-powerful manager.
         APIInteractionManager apiManager;
+        apiManager.setCacheEnabled(useCache); // Honor --no-cache.
 
-        // Do the deed — one request to rule them all.
-        std::string responseText = apiManager.performAPIInteraction(
-            endpoint, inputFile, apiName, method
-        );
-
-        // Process and save the response like the data hoarder you are.
-        APIResponseHandler::processResponse(
-            cpr::Response{200, "", responseText, {}, cpr::Url{endpoint}},
-            APIResponseHandler::ResponseFormat::JSON,
-            outputPath
+        // Do the deed — one request to rule them all, streamed to disk as it lands.
+        std::string savedTo = apiManager.downloadAPIInteraction(
+            endpoint, inputFile, apiName, method, outputPath
         );
 
         // Log success because we deserve it.
-        APIInteractionLogger::log(APIInteractionLogger::LogLevel::INFO,
-            "Request completed successfully. Output saved to: " + outputPath + ".json");
+        API_LOG(Info, "api.done", {{"output", savedTo}});
 
+        if (showStats) std::cerr << RequestMetrics::process().summaryJson() << "\n"; // The receipts.
         return 0; // Mission accomplished, no survivors (except us).
     } catch (const std::exception& e) {
         // Catastrophic meltdown caught here.
-        APIInteractionLogger::log(APIInteractionLogger::LogLevel::ERROR,
-            std::string("Fatal Error: ") + e.what());
+        API_LOG(Error, "api.fatal", {{"error", e.what()}});
+        if (showStats) std::cerr << RequestMetrics::process().summaryJson() << "\n"; // Receipts for the post-mortem.
         return 1; // Exit in shame.
     }
 }
@@ -9,21 +9,136 @@ let g:API_endpoint_url = 'https://generativelanguage.googleapis.com/v1beta/model
 
 let g:API_key_env= 'API_KEY'  "This pulls from the VImBigHelper
 
+" 3. Keep one helper process alive ("--serve") and talk to it over a JSON
+"    channel instead of spawning the binary for every prompt. Needs +job.
+let g:API_use_daemon = 1
+let g:API_timeout_ms = 60000
+
+" 4. Where the answer sits in the reply, as JSON pointers tried in order.
+"    Empty means Gemini's /candidates/0/content/parts/0/text.
+let g:API_response_paths = []
+
+" 5. Compress large prompts before upload: 'gzip', 'zstd' (if the helper was
+"    built with it), or '' to send them as they are.
+let g:API_compress = ''
+
+" Options for the helper: --path pairs for the configured pointers, then
+" --compress
+function! s:HelperArgs() abort
+    let l:args = []
+    for l:path in g:API_response_paths
+        call extend(l:args, ['--path', l:path])
+    endfor
+    if !empty(g:API_compress)
+        call extend(l:args, ['--compress', g:API_compress])
+    endif
+    return l:args
+endfunction
+
+let s:api_job = ''
+
+" Returns the channel of the running helper daemon, starting it on first use.
+" Returns '' when the daemon is disabled or could not be started, in which
+" case callers fall back to one system() call per prompt.
+function! s:DaemonChannel() abort
+    if !g:API_use_daemon || !has('job') || !has('channel')
+        return ''
+    endif
+    if type(s:api_job) == v:t_job && job_status(s:api_job) ==# 'run'
+        return job_getchannel(s:api_job)
+    endif
+    let s:api_job = job_start([expand(g:VIM_binary_path), '--serve'] + s:HelperArgs() + [g:API_endpoint_url],
+                \ {'mode': 'json', 'err_io': 'null', 'callback': function('s:OnDaemonMessage')})
+    if job_status(s:api_job) !=# 'run'
+        return ''
+    endif
+    return job_getchannel(s:api_job)
+endfunction
+
+" Streamed answers in flight: tag -> {'buf': bufnr, 'lnum': line being filled}
+let s:streams = {}
+let s:stream_tag = 0
+
+" Handles messages the daemon pushes without being asked ([0, {...}]),
+" which are the text deltas of streamed requests.
+function! s:OnDaemonMessage(channel, msg) abort
+    if type(a:msg) != v:t_dict || !has_key(a:msg, 'delta') || !has_key(s:streams, a:msg.tag)
+        return
+    endif
+    let l:target = s:streams[a:msg.tag]
+    let l:pieces = split(a:msg.delta, "\n", 1)
+    let l:line = get(getbufline(l:target.buf, l:target.lnum), 0, '')
+    call setbufline(l:target.buf, l:target.lnum, l:line . l:pieces[0])
+    if len(l:pieces) > 1
+        call appendbufline(l:target.buf, l:target.lnum, l:pieces[1:])
+        let l:target.lnum += len(l:pieces) - 1
+    endif
+    redraw
+endfunction
+
+function! s:OnStreamDone(tag, channel, msg) abort
+    call remove(s:streams, a:tag)
+    if type(a:msg) == v:t_dict && has_key(a:msg, 'error')
+        echohl ErrorMsg
+        echom "API Error: " . a:msg.error
+        echohl None
+    endif
+endfunction
+
+" Streams the answer to a:prompt into the current buffer below a:lnum as it
+" is generated. Returns immediately; the editor stays usable meanwhile.
+function! API_Stream(prompt, lnum) abort
+    let l:channel = s:DaemonChannel()
+    if type(l:channel) != v:t_channel
+        " No daemon: fall back to a blocking call
+        let l:output = API_Call(a:prompt)
+        if !empty(l:output)
+            call append(a:lnum, split(l:output, "\n"))
+        endif
+        return
+    endif
+    let s:stream_tag += 1
+    call append(a:lnum, '')
+    let s:streams[s:stream_tag] = {'buf': bufnr('%'), 'lnum': a:lnum + 1}
+    call ch_sendexpr(l:channel, {'endpoint': g:API_endpoint_url, 'prompt': a:prompt,
+                \ 'stream': v:true, 'tag': s:stream_tag},
+                \ {'callback': function('s:OnStreamDone', [s:stream_tag])})
+endfunction
+
+augroup APIHelperDaemon
+    autocmd!
+    autocmd VimLeavePre * if type(s:api_job) == v:t_job | call job_stop(s:api_job) | endif
+augroup END
+
 " This function captures the current visual selection or the current line as the prompt.
 function! API_Call(prompt, ...) abort
-    if a:0 >=1
+    if a:0 >=1 && !empty(a:1)
         let l:endpoint= a:1
     else 
-        let l:endpoint=g.API_endpoint_url
+        let l:endpoint=g:API_endpoint_url
+    endif
+
+    " Fast path: hand the prompt to the long-running helper
+    let l:channel = s:DaemonChannel()
+    if type(l:channel) == v:t_channel
+        let l:reply = ch_evalexpr(l:channel, {'endpoint': l:endpoint, 'prompt': a:prompt},
+                    \ {'timeout': g:API_timeout_ms})
+        if type(l:reply) != v:t_dict || has_key(l:reply, 'error')
+            echohl ErrorMsg
+            echom "API Error: " . (type(l:reply) == v:t_dict ? l:reply.error : 'no reply from helper')
+            echohl None
+            return
+        endif
+        return l:reply.text
     endif
 
     " Shell-escape the arguments to handle spaces and special characters
-    let l:endpoint_esc = shellescape(g:API_endpoint_url)
+    let l:endpoint_esc = shellescape(l:endpoint)
     let l:prompt_esc = shellescape(a:prompt)
     let l:binary_esc = shellescape(g:VIM_binary_path)
     
     " Construct the full shell command: <binary> <endpoint> <prompt>
-    let l:cmd = l:binary_esc . ' ' . l:endpoint_esc . ' ' . l:prompt_esc
+    let l:cmd = l:binary_esc . ' ' . join(map(s:HelperArgs(), 'shellescape(v:val)')) . ' ' . l:endpoint_esc . ' ' . l:prompt_esc
     
     " Use the system() function to execute the command and capture its stdout
     let l:result = system(l:cmd)
@@ -160,3 +275,42 @@ function! s:PromptAndAppend() abort
     call append(line('.'), split(l:output, "\n"))
 endfunction
 
+nnoremap <silent> <leader>gs :call s:PromptAndStream()<CR>
+
+function! s:PromptAndStream() abort
+    let l:prompt = input('API Prompt: ')
+    if empty(l:prompt)
+        return
+    endif
+    call API_Stream(l:prompt, line('.'))
+endfunction
+
+" :APIStats shows where the daemon's requests spent their time (DNS, connect,
+" TLS, server, transfer, total; p50/p90/p99 per endpoint) in a scratch buffer.
+command! APIStats call s:ShowStats()
+
+function! s:ShowStats() abort
+    let l:channel = s:DaemonChannel()
+    if type(l:channel) != v:t_channel
+        echohl ErrorMsg | echom "API Error: stats need the helper daemon (g:API_use_daemon)" | echohl None
+        return
+    endif
+    let l:reply = ch_evalexpr(l:channel, {'command': 'stats'}, {'timeout': 2000})
+    if type(l:reply) != v:t_dict || !has_key(l:reply, 'stats')
+        echohl ErrorMsg | echom "API Error: no stats from helper" | echohl None
+        return
+    endif
+    let l:lines = []
+    for [l:endpoint, l:agg] in items(l:reply.stats.endpoints)
+        call add(l:lines, printf('%s  requests %d  errors %d  cache hits %d  retries %d',
+                    \ l:endpoint, l:agg.requests, l:agg.errors, l:agg.cache_hits, l:agg.retries))
+        for l:phase in ['dns', 'connect', 'tls', 'server', 'transfer', 'total']
+            let l:h = l:agg[l:phase]
+            call add(l:lines, printf('  %-9s p50 %9.2f ms   p90 %9.2f ms   p99 %9.2f ms   max %9.2f ms',
+                        \ l:phase, l:h.p50_ms, l:h.p90_ms, l:h.p99_ms, l:h.max_ms))
+        endfor
+    endfor
+    new
+    setlocal buftype=nofile bufhidden=wipe noswapfile
+    call setline(1, empty(l:lines) ? ['No requests yet'] : l:lines)
+endfunction
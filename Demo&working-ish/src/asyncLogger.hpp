@@ -0,0 +1,339 @@
+#pragma once
+
+// Logging that stays off the request path.
+//
+// API_LOG(Info, "request.done", {{"status", 200}, {"path", out}}) formats the
+// event and its key=value fields straight into a fixed-size slot of a
+// lock-free ring buffer and returns; a background thread prefixes timestamp
+// and level and writes whole batches to stderr (or API_LOG_FILE) with one
+// write() each. Nothing goes to stdout, which belongs to the API answer.
+//
+// Levels below API_LOG_MIN_LEVEL (default: Debug in debug builds, Info with
+// NDEBUG) are compiled out: their arguments are never even evaluated.
+// API_LOG_LEVEL=debug|info|warning|error raises the bar further at run time.
+// When the buffer is full records are dropped (and counted), never waited on.
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <initializer_list>
+#include <type_traits>
+#include <charconv>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef API_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define API_LOG_MIN_LEVEL 1
+#else
+#define API_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#define API_LOG(LEVEL, ...)                                                                  \
+    do {                                                                                     \
+        if constexpr (AsyncLogger::compiledIn(AsyncLogger::Level::LEVEL)) {                  \
+            AsyncLogger& api_logger_ = AsyncLogger::instance();                              \
+            if (api_logger_.enabled(AsyncLogger::Level::LEVEL)) {                            \
+                api_logger_.write(AsyncLogger::Level::LEVEL, __VA_ARGS__);                   \
+            }                                                                                \
+        }                                                                                    \
+    } while (0)
+
+class AsyncLogger {
+public:
+    enum class Level : int { Debug = 0, Info = 1, Warning = 2, Error = 3 };
+
+    // One key=value pair. Holds views only; it is formatted before write() returns.
+    class Field {
+    public:
+        Field(const char* key, std::string_view value) : key_(key), kind_(Kind::Text), text_(value) {}
+        Field(const char* key, const std::string& value) : Field(key, std::string_view(value)) {}
+        Field(const char* key, const char* value) : Field(key, std::string_view(value ? value : "")) {}
+        Field(const char* key, bool value) : key_(key), kind_(Kind::Bool) { number_.b = value; }
+        Field(const char* key, double value) : key_(key), kind_(Kind::Double) { number_.d = value; }
+        template <typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+        Field(const char* key, T value) : key_(key) {
+            if constexpr (std::is_signed_v<T>) {
+                kind_ = Kind::Signed;
+                number_.i = (int64_t)value;
+            } else {
+                kind_ = Kind::Unsigned;
+                number_.u = (uint64_t)value;
+            }
+        }
+
+    private:
+        friend class AsyncLogger;
+        enum class Kind { Text, Signed, Unsigned, Double, Bool };
+        const char* key_;
+        Kind kind_;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            bool b;
+        } number_{};
+        std::string_view text_;
+    };
+
+    static constexpr bool compiledIn(Level level) { return (int)level >= API_LOG_MIN_LEVEL; }
+
+    static AsyncLogger& instance() {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    bool enabled(Level level) const { return (int)level >= min_level_; }
+
+    void write(Level level, std::string_view event, std::initializer_list<Field> fields = {}) {
+        size_t position = head_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[position & (kSlots - 1)];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t lag = (intptr_t)sequence - (intptr_t)position;
+            if (lag == 0) {
+                if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed); // Full: the writer is behind
+                return;
+            } else {
+                position = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        slot->time = std::chrono::system_clock::now();
+        Formatter out{slot->text, 0};
+        out.append(event);
+        for (const Field& field : fields) {
+            out.append(" ");
+            out.append(field.key_);
+            out.append("=");
+            out.value(field);
+        }
+        slot->length = (uint16_t)out.length;
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        if (writer_idle_.load()) {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            wake_.notify_one();
+        }
+    }
+
+    // Blocks until every record written so far is out of the buffer.
+    void flush() {
+        size_t target = head_.load();
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+        drained_.wait(lock, [&] { return written_ >= target || stop_; });
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    ~AsyncLogger() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+            wake_.notify_one();
+        }
+        writer_.join();
+        if (owns_fd_) ::close(fd_);
+    }
+
+private:
+    static constexpr size_t kSlots = 1024;         // Power of two
+    static constexpr size_t kRecordBytes = 496;    // Longer records are cut with "..."
+
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        Level level = Level::Info;
+        std::chrono::system_clock::time_point time;
+        uint16_t length = 0;
+        char text[kRecordBytes];
+    };
+
+    // Appends into a slot without allocating; quietly truncates.
+    struct Formatter {
+        char* buffer;
+        size_t length;
+
+        void append(std::string_view text) {
+            size_t room = kRecordBytes - length;
+            if (text.size() > room) {
+                std::memcpy(buffer + length, text.data(), room);
+                length = kRecordBytes;
+                std::memcpy(buffer + kRecordBytes - 3, "...", 3);
+                return;
+            }
+            std::memcpy(buffer + length, text.data(), text.size());
+            length += text.size();
+        }
+
+        void value(const Field& field) {
+            char number[32];
+            std::to_chars_result result{number, std::errc()};
+            switch (field.kind_) {
+                case Field::Kind::Text: return text(field.text_);
+                case Field::Kind::Bool: return append(field.number_.b ? "true" : "false");
+                case Field::Kind::Signed: result = std::to_chars(number, number + sizeof(number), field.number_.i); break;
+                case Field::Kind::Unsigned: result = std::to_chars(number, number + sizeof(number), field.number_.u); break;
+                case Field::Kind::Double: {
+                    int n = std::snprintf(number, sizeof(number), "%g", field.number_.d);
+                    result.ptr = number + (n > 0 ? std::min<int>(n, sizeof(number) - 1) : 0);
+                    break;
+                }
+            }
+            append(std::string_view(number, (size_t)(result.ptr - number)));
+        }
+
+        // Bare when unambiguous, otherwise quoted with \" \\ \n escaped.
+        void text(std::string_view value) {
+            bool bare = !value.empty();
+            for (char c : value) {
+                if (c == ' ' || c == '=' || c == '"' || c == '\\' || (unsigned char)c < 0x20) {
+                    bare = false;
+                    break;
+                }
+            }
+            if (bare) return append(value);
+            append("\"");
+            for (char c : value) {
+                if (c == '"' || c == '\\') {
+                    char escaped[2] = {'\\', c};
+                    append(std::string_view(escaped, 2));
+                } else if (c == '\n') {
+                    append("\\n");
+                } else if ((unsigned char)c < 0x20) {
+                    append(" ");
+                } else {
+                    append(std::string_view(&c, 1));
+                }
+            }
+            append("\"");
+        }
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> head_{0};  // Next slot producers claim
+    alignas(64) size_t tail_ = 0;              // Next slot the writer reads (writer thread only)
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> writer_idle_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    size_t written_ = 0;   // Records written out, guarded by wake_mutex_
+    bool stop_ = false;    // Guarded by wake_mutex_
+    int min_level_ = API_LOG_MIN_LEVEL;
+    int fd_ = STDERR_FILENO;
+    bool owns_fd_ = false;
+    std::thread writer_;
+
+    AsyncLogger() : slots_(new Slot[kSlots]) {
+        for (size_t i = 0; i < kSlots; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+
+        if (const char* level = std::getenv("API_LOG_LEVEL")) {
+            std::string_view name(level);
+            int wanted = name == "debug" ? 0 : name == "info" ? 1 : name == "warning" ? 2 : name == "error" ? 3 : -1;
+            if (wanted > min_level_) min_level_ = wanted;
+        }
+        if (const char* path = std::getenv("API_LOG_FILE")) {
+            int fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (fd >= 0) {
+                fd_ = fd;
+                owns_fd_ = true;
+            }
+        }
+        writer_ = std::thread([this] { run(); });
+    }
+
+    static const char* levelName(Level level) {
+        switch (level) {
+            case Level::Debug: return "DEBUG";
+            case Level::Info: return "INFO";
+            case Level::Warning: return "WARNING";
+            case Level::Error: return "ERROR";
+        }
+        return "?";
+    }
+
+    // Moves every published record into `batch`; returns how many.
+    size_t drain(std::string& batch) {
+        size_t count = 0;
+        while (true) {
+            Slot& slot = slots_[tail_ & (kSlots - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) break;
+
+            auto since_epoch = slot.time.time_since_epoch();
+            std::time_t seconds = (std::time_t)std::chrono::duration_cast<std::chrono::seconds>(since_epoch).count();
+            int millis = (int)(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count() % 1000);
+            std::tm utc;
+            gmtime_r(&seconds, &utc);
+            char prefix[64];
+            size_t n = std::strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &utc);
+            n += (size_t)std::snprintf(prefix + n, sizeof(prefix) - n, ".%03dZ %s ", millis, levelName(slot.level));
+            batch.append(prefix, n);
+            batch.append(slot.text, slot.length);
+            batch += '\n';
+
+            slot.sequence.store(tail_ + kSlots, std::memory_order_release); // Hand the slot back
+            ++tail_;
+            ++count;
+        }
+        return count;
+    }
+
+    void emit(const std::string& batch) {
+        size_t done = 0;
+        while (done < batch.size()) {
+            ssize_t n = ::write(fd_, batch.data() + done, batch.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break; // Nowhere to log to; nothing sensible left to do
+            done += (size_t)n;
+        }
+    }
+
+    void run() {
+        std::string batch;
+        uint64_t reported_drops = 0;
+        while (true) {
+            batch.clear();
+            size_t count = drain(batch);
+            uint64_t drops = dropped();
+            if (drops != reported_drops) {
+                batch += "logger: dropped " + std::to_string(drops - reported_drops) + " records (buffer full)\n";
+                reported_drops = drops;
+            }
+            if (!batch.empty()) emit(batch);
+
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            written_ += count;
+            drained_.notify_all();
+            if (count > 0) continue;
+            if (stop_) return; // Only after a pass that found nothing left
+            writer_idle_ = true;
+            // Re-check after announcing we are idle: a producer that saw us
+            // busy did not notify.
+            Slot& next = slots_[tail_ & (kSlots - 1)];
+            if (next.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+                wake_.wait_for(lock, std::chrono::milliseconds(200));
+            }
+            writer_idle_ = false;
+        }
+    }
+};
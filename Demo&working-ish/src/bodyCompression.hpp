@@ -0,0 +1,238 @@
+#pragma once
+
+// Opt-in compression of request bodies.
+//
+// Prompts and uploaded buffers are source code and logs, which shrink 4-10x,
+// and on a slow uplink the upload is most of the request. With
+// API_COMPRESS=gzip (or zstd, optionally with a level: "zstd:6") bodies of at
+// least API_COMPRESS_MIN_BYTES (default 1024) are sent with Content-Encoding.
+// Smaller bodies go as they are: below about a kilobyte the header and the CPU
+// cost more than the bytes saved. zstd is only available when built with
+// API_HAVE_ZSTD (the CMake build defines it when libzstd is found).
+//
+// BodyCompressor produces the compressed stream piece by piece, so a mapped
+// file is compressed as curl's read callback asks for it instead of into a
+// second copy in memory. The compressed length is not known up front, so
+// such bodies go out chunked (HTTP/1.1) or without a length (HTTP/2).
+//
+// Responses need nothing from here: setting CURLOPT_ACCEPT_ENCODING to ""
+// makes curl advertise every encoding it was built with and decode replies
+// before the write callback sees them.
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdlib>
+#include <climits>
+#include <zlib.h>
+#ifdef API_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+enum class BodyEncoding { Identity, Gzip, Zstd };
+
+struct RequestCompression {
+    BodyEncoding encoding = BodyEncoding::Identity;
+    int level = 0;            // 0: the codec's default
+    size_t min_bytes = 1024;  // Smaller bodies are sent uncompressed
+
+    // "gzip", "zstd", "gzip:9", ... ; "" or "none" turns compression off.
+    static RequestCompression parse(const std::string& spec) {
+        RequestCompression compression;
+        std::string name = spec.substr(0, spec.find(':'));
+        if (spec.find(':') != std::string::npos) {
+            compression.level = std::atoi(spec.c_str() + spec.find(':') + 1);
+        }
+        if (name.empty() || name == "none" || name == "identity") {
+            compression.encoding = BodyEncoding::Identity;
+        } else if (name == "gzip") {
+            compression.encoding = BodyEncoding::Gzip;
+        } else if (name == "zstd") {
+#ifdef API_HAVE_ZSTD
+            compression.encoding = BodyEncoding::Zstd;
+#else
+            throw std::runtime_error("zstd compression was not compiled in; use gzip");
+#endif
+        } else {
+            throw std::runtime_error("Unknown compression: " + spec + " (expected gzip or zstd)");
+        }
+        return compression;
+    }
+
+    // Process-wide setting from API_COMPRESS and API_COMPRESS_MIN_BYTES;
+    // command-line flags overwrite it before the first request.
+    static RequestCompression& process() {
+        static RequestCompression compression = [] {
+            const char* spec = std::getenv("API_COMPRESS");
+            RequestCompression configured = parse(spec ? spec : "");
+            if (const char* min_bytes = std::getenv("API_COMPRESS_MIN_BYTES")) {
+                configured.min_bytes = (size_t)std::strtoull(min_bytes, nullptr, 10);
+            }
+            return configured;
+        }();
+        return compression;
+    }
+
+    bool appliesTo(size_t body_bytes) const {
+        return encoding != BodyEncoding::Identity && body_bytes >= min_bytes;
+    }
+
+    // Value for the Content-Encoding header
+    const char* contentEncoding() const {
+        switch (encoding) {
+            case BodyEncoding::Gzip: return "gzip";
+            case BodyEncoding::Zstd: return "zstd";
+            case BodyEncoding::Identity: break;
+        }
+        return "identity";
+    }
+
+    // Whole body at once, for bodies that already live in memory.
+    std::string compress(std::string_view body) const;
+};
+
+// Pull-style compressor over a source that stays alive (and unchanged) for
+// as long as the compressor does.
+class BodyCompressor {
+public:
+    BodyCompressor(const RequestCompression& compression, std::string_view source)
+        : encoding_(compression.encoding), level_(compression.level), source_(source) {
+        begin();
+    }
+
+    ~BodyCompressor() { end(); }
+
+    BodyCompressor(const BodyCompressor&) = delete;
+    BodyCompressor& operator=(const BodyCompressor&) = delete;
+
+    // Fills up to `capacity` bytes of compressed output; 0 once the stream
+    // is complete. Throws on codec errors.
+    size_t read(char* out, size_t capacity) {
+        if (finished_ || capacity == 0) return 0;
+        if (encoding_ == BodyEncoding::Gzip) return readGzip(out, capacity);
+#ifdef API_HAVE_ZSTD
+        if (encoding_ == BodyEncoding::Zstd) return readZstd(out, capacity);
+#endif
+        // Identity: a plain copy, so callers need no special case
+        size_t count = std::min(capacity, source_.size() - offset_);
+        std::copy_n(source_.data() + offset_, count, out);
+        offset_ += count;
+        return count;
+    }
+
+    // Starts the stream over from the first byte (curl rewinds bodies on
+    // redirects and auth retries).
+    void restart() {
+        end();
+        begin();
+    }
+
+private:
+    // Input is handed to the codec in slices so the mapped file is paged in
+    // as we go, and because zlib counts in 32-bit units.
+    static constexpr size_t kSlice = 256 * 1024;
+
+    BodyEncoding encoding_;
+    int level_;
+    std::string_view source_;
+    size_t offset_ = 0;      // Source bytes handed to the codec so far
+    bool finished_ = false;
+    z_stream zlib_{};
+#ifdef API_HAVE_ZSTD
+    ZSTD_CCtx* zstd_ = nullptr;
+    ZSTD_inBuffer zstd_in_{nullptr, 0, 0};
+#endif
+
+    void begin() {
+        offset_ = 0;
+        finished_ = false;
+        if (encoding_ == BodyEncoding::Gzip) {
+            zlib_ = z_stream{};
+            // 15 window bits + 16: gzip framing rather than a raw zlib stream
+            if (deflateInit2(&zlib_, level_ > 0 ? std::min(level_, 9) : Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                             15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("Failed to initialize gzip compression.");
+            }
+        }
+#ifdef API_HAVE_ZSTD
+        if (encoding_ == BodyEncoding::Zstd) {
+            zstd_ = ZSTD_createCCtx();
+            if (!zstd_) throw std::runtime_error("Failed to initialize zstd compression.");
+            ZSTD_CCtx_setParameter(zstd_, ZSTD_c_compressionLevel, level_ > 0 ? level_ : ZSTD_CLEVEL_DEFAULT);
+            ZSTD_CCtx_setPledgedSrcSize(zstd_, source_.size()); // Lets it size its window to the input
+            zstd_in_ = ZSTD_inBuffer{nullptr, 0, 0};
+        }
+#endif
+    }
+
+    void end() {
+        if (encoding_ == BodyEncoding::Gzip) deflateEnd(&zlib_);
+#ifdef API_HAVE_ZSTD
+        if (zstd_) ZSTD_freeCCtx(zstd_);
+        zstd_ = nullptr;
+#endif
+    }
+
+    size_t readGzip(char* out, size_t capacity) {
+        zlib_.next_out = reinterpret_cast<Bytef*>(out);
+        zlib_.avail_out = (uInt)std::min<size_t>(capacity, UINT_MAX);
+        while (zlib_.avail_out > 0) {
+            if (zlib_.avail_in == 0 && offset_ < source_.size()) {
+                size_t slice = std::min(kSlice, source_.size() - offset_);
+                zlib_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(source_.data() + offset_));
+                zlib_.avail_in = (uInt)slice;
+                offset_ += slice;
+            }
+            int flush = zlib_.avail_in == 0 && offset_ == source_.size() ? Z_FINISH : Z_NO_FLUSH;
+            int rc = deflate(&zlib_, flush);
+            if (rc == Z_STREAM_END) {
+                finished_ = true;
+                break;
+            }
+            if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                throw std::runtime_error("gzip compression failed.");
+            }
+        }
+        return capacity - zlib_.avail_out;
+    }
+
+#ifdef API_HAVE_ZSTD
+    size_t readZstd(char* out, size_t capacity) {
+        ZSTD_outBuffer output{out, capacity, 0};
+        while (output.pos < output.size) {
+            if (zstd_in_.pos == zstd_in_.size && offset_ < source_.size()) {
+                size_t slice = std::min(kSlice, source_.size() - offset_);
+                zstd_in_ = ZSTD_inBuffer{source_.data() + offset_, slice, 0};
+                offset_ += slice;
+            }
+            bool last = zstd_in_.pos == zstd_in_.size && offset_ == source_.size();
+            size_t remaining = ZSTD_compressStream2(zstd_, &output, &zstd_in_, last ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining)) {
+                throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+            }
+            if (last && remaining == 0) {
+                finished_ = true;
+                break;
+            }
+        }
+        return output.pos;
+    }
+#endif
+};
+
+inline std::string RequestCompression::compress(std::string_view body) const {
+    BodyCompressor compressor(*this, body);
+    std::string compressed;
+    size_t used = 0;
+    while (true) {
+        // Source text typically shrinks several-fold; grow if it doesn't
+        compressed.resize(std::max<size_t>(used + 4096, compressed.size() + body.size() / 4 + 64));
+        size_t n = compressor.read(&compressed[used], compressed.size() - used);
+        used += n;
+        if (n == 0) break;
+    }
+    compressed.resize(used);
+    return compressed;
+}
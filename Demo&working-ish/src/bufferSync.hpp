@@ -0,0 +1,411 @@
+#pragma once
+
+// Incremental upload of buffers that were sent before.
+//
+// Every buffer is cut into content-defined chunks (a gear rolling hash picks
+// the cut points, 2-64 KiB, 8 KiB on average), so an edit only changes the
+// chunks around it. After a server has acknowledged a version of a buffer,
+// the next upload is a delta against that version: a manifest of operations,
+// "copy this range of the old version" for chunks it already has and
+// "literal" for the rest, followed by the literal bytes. One changed line in
+// a 5 MB file costs a few KiB.
+//
+// Protocol (see bench/sync_receiver.py for a reference receiver):
+//   * Full uploads are sent as usual plus "X-Buffer-Sync: 1". A server that
+//     understands deltas keeps the body, keyed by its SHA-256, and answers
+//     with "X-Buffer-Sync: stored=<sha256>". Other servers ignore the header
+//     and nothing else happens.
+//   * A delta is sent with Content-Type application/x-buffer-delta and
+//     "X-Buffer-Sync: 1". The body is one line of JSON,
+//       {"base":"<sha256>","target":"<sha256>","size":N,"content_type":"...",
+//        "ops":[["c",offset,length],["l",length],...]}
+//     then the literal bytes, in op order. The server rebuilds the buffer,
+//     checks it against "target", and handles the request as if the whole
+//     buffer had been posted.
+//   * 400/404/405/409/415/422/501 to a delta (server lost the base, or never
+//     supported deltas) make the client send the full buffer instead.
+//
+// What each buffer looked like when the server last stored it is kept under
+// <cache dir>/sync, one small manifest file per (endpoint, buffer id). Those
+// files are only a hint: a stale or missing one costs a full upload, never a
+// wrong one, because the server verifies the rebuilt buffer's hash.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <memory>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "requestBatch.hpp"
+#include "responseCache.hpp"
+
+// Plain SHA-256, for naming whole buffers.
+class Sha256 {
+public:
+    Sha256() { reset(); }
+
+    void update(std::string_view data) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+        size_t n = data.size();
+        length_ += n;
+        if (buffered_ > 0) {
+            size_t take = std::min(n, sizeof(block_) - buffered_);
+            std::memcpy(block_ + buffered_, p, take);
+            buffered_ += take;
+            p += take;
+            n -= take;
+            if (buffered_ < sizeof(block_)) return;
+            compress(block_);
+            buffered_ = 0;
+        }
+        for (; n >= sizeof(block_); p += sizeof(block_), n -= sizeof(block_)) compress(p);
+        std::memcpy(block_, p, n);
+        buffered_ = n;
+    }
+
+    std::string hex() {
+        uint64_t bits = length_ * 8;
+        unsigned char pad = 0x80;
+        update(std::string_view(reinterpret_cast<const char*>(&pad), 1));
+        unsigned char zero = 0;
+        while (buffered_ != 56) update(std::string_view(reinterpret_cast<const char*>(&zero), 1));
+        unsigned char tail[8];
+        for (int i = 0; i < 8; ++i) tail[i] = (unsigned char)(bits >> (56 - 8 * i));
+        update(std::string_view(reinterpret_cast<const char*>(tail), 8));
+
+        char out[65];
+        for (int i = 0; i < 8; ++i) std::snprintf(out + 8 * i, 9, "%08x", state_[i]);
+        reset();
+        return std::string(out, 64);
+    }
+
+    static std::string of(std::string_view data) {
+        Sha256 sha;
+        sha.update(data);
+        return sha.hex();
+    }
+
+private:
+    uint32_t state_[8];
+    unsigned char block_[64];
+    size_t buffered_ = 0;
+    uint64_t length_ = 0;
+
+    void reset() {
+        static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(state_, initial, sizeof(state_));
+        buffered_ = 0;
+        length_ = 0;
+    }
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const unsigned char* p) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+        state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+    }
+};
+
+// Content-defined chunking with a gear hash (the FastCDC scheme: a stricter
+// mask before the average size and a looser one after it, which keeps chunk
+// sizes close to the average).
+class ContentChunker {
+public:
+    static constexpr size_t kMinSize = 2 * 1024;
+    static constexpr size_t kAvgSize = 8 * 1024;
+    static constexpr size_t kMaxSize = 64 * 1024;
+
+    struct Chunk {
+        uint64_t hash;   // Of the chunk's bytes; see chunkHash()
+        size_t offset;
+        size_t length;
+    };
+
+    static std::vector<Chunk> split(std::string_view data) {
+        std::vector<Chunk> chunks;
+        chunks.reserve(data.size() / kAvgSize + 1);
+        size_t offset = 0;
+        while (offset < data.size()) {
+            size_t length = cut(reinterpret_cast<const unsigned char*>(data.data()) + offset, data.size() - offset);
+            chunks.push_back({chunkHash(data.substr(offset, length)), offset, length});
+            offset += length;
+        }
+        return chunks;
+    }
+
+    // 64-bit multiply-mix over 8-byte words. A collision can only cost a
+    // rejected delta (the server checks the whole buffer's SHA-256).
+    static uint64_t chunkHash(std::string_view data) {
+        const uint64_t m = 0x9e3779b97f4a7c15ull;
+        uint64_t h = 0x243f6a8885a308d3ull ^ (data.size() * m);
+        size_t i = 0;
+        for (; i + 8 <= data.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, 8);
+            h = (h ^ mix(word)) * m;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data.data() + i, data.size() - i);
+        h = (h ^ mix(tail ^ (uint64_t)(data.size() - i))) * m;
+        return mix(h);
+    }
+
+private:
+    // Cut points depend on the top bits, which see the last 64 bytes
+    static constexpr uint64_t kMaskStrict = 0xfffe000000000000ull; // 15 bits
+    static constexpr uint64_t kMaskLoose = 0xffe0000000000000ull;  // 11 bits
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static const std::array<uint64_t, 256>& gear() {
+        static const std::array<uint64_t, 256> table = [] {
+            std::array<uint64_t, 256> values{};
+            uint64_t seed = 0x5eed5eed5eed5eedull; // Fixed: cut points must not change between runs
+            for (auto& value : values) value = mix(seed += 0x9e3779b97f4a7c15ull);
+            return values;
+        }();
+        return table;
+    }
+
+    static size_t cut(const unsigned char* data, size_t size) {
+        if (size <= kMinSize) return size;
+        size_t limit = std::min(size, kMaxSize);
+        size_t normal = std::min(limit, kAvgSize);
+        const std::array<uint64_t, 256>& table = gear();
+        uint64_t hash = 0;
+        size_t i = kMinSize;
+        for (; i < normal; ++i) {
+            hash = (hash << 1) + table[data[i]];
+            if (!(hash & kMaskStrict)) return i + 1;
+        }
+        for (; i < limit; ++i) {
+            hash = (hash << 1) + table[data[i]];
+            if (!(hash & kMaskLoose)) return i + 1;
+        }
+        return limit;
+    }
+};
+
+class BufferSync {
+public:
+    // Manifests live in <directory>; an empty directory turns syncing off
+    // (every upload is a plain full one).
+    explicit BufferSync(std::string directory = defaultDirectory()) : directory_(std::move(directory)) {
+        if (!directory_.empty()) {
+            ::mkdir(directory_.substr(0, directory_.rfind('/')).c_str(), 0700);
+            ::mkdir(directory_.c_str(), 0700);
+        }
+    }
+
+    static std::string defaultDirectory() {
+        std::string cache = ResponseCache::defaultOptions().directory;
+        return cache.empty() ? "" : cache + "/sync";
+    }
+
+    // Sends `request`, whose body (body_file or body) is the current content
+    // of `buffer_id`, as a delta when the endpoint has stored an earlier
+    // version, else in full. Returns the final result like RequestBatch::run().
+    BatchResult send(RequestBatch& client, BatchRequest request, const std::string& buffer_id) {
+        std::string_view content = request.body_file ? request.body_file->view() : std::string_view(request.body);
+        std::string state_path = statePath(request.url, buffer_id);
+        Manifest current = Manifest::of(content);
+
+        BatchResult result;
+        bool sent = false;
+        if (std::optional<Manifest> base = load(state_path)) {
+            if (std::optional<BatchRequest> delta = deltaRequest(request, *base, current, content)) {
+                result = client.run({*delta}).front();
+                sent = !needsFullUpload(result);
+                if (!sent && request.sink && !request.sink->rewind()) sent = true; // Can't take it back
+            }
+        }
+        if (!sent) {
+            request.headers.push_back("X-Buffer-Sync: 1");
+            result = client.run({request}).front();
+        }
+
+        if (result.status >= 200 && result.status < 300 && storedHash(result) == current.sha256) {
+            save(state_path, current);
+        } else if (result.status >= 200 && result.status < 300) {
+            std::remove(state_path.c_str()); // Server doesn't keep versions (any more)
+        }
+        return result;
+    }
+
+private:
+    // Chunk layout and hash of one version of a buffer.
+    struct Manifest {
+        std::string sha256;
+        size_t size = 0;
+        std::vector<ContentChunker::Chunk> chunks;
+
+        static Manifest of(std::string_view content) {
+            Manifest manifest;
+            manifest.sha256 = Sha256::of(content);
+            manifest.size = content.size();
+            manifest.chunks = ContentChunker::split(content);
+            return manifest;
+        }
+    };
+
+    std::string directory_;
+
+    std::string statePath(const std::string& endpoint, const std::string& buffer_id) const {
+        if (directory_.empty()) return "";
+        return directory_ + "/" + ResponseCache::makeKey(endpoint, "SYNC", {}, buffer_id).hex();
+    }
+
+    // Manifest file: "buffer-sync 1 <sha256> <size>", then "<hash> <offset> <length>" per chunk.
+    std::optional<Manifest> load(const std::string& path) const {
+        if (path.empty()) return std::nullopt;
+        std::ifstream file(path);
+        std::string magic;
+        int version = 0;
+        Manifest manifest;
+        if (!(file >> magic >> version >> manifest.sha256 >> manifest.size) || magic != "buffer-sync" || version != 1) {
+            return std::nullopt;
+        }
+        ContentChunker::Chunk chunk{};
+        while (file >> std::hex >> chunk.hash >> std::dec >> chunk.offset >> chunk.length) {
+            manifest.chunks.push_back(chunk);
+        }
+        return manifest;
+    }
+
+    void save(const std::string& path, const Manifest& manifest) const {
+        if (path.empty()) return;
+        std::string temp_path = path + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream file(temp_path, std::ios::trunc);
+            file << "buffer-sync 1 " << manifest.sha256 << ' ' << manifest.size << '\n';
+            for (const auto& chunk : manifest.chunks) {
+                file << std::hex << chunk.hash << std::dec << ' ' << chunk.offset << ' ' << chunk.length << '\n';
+            }
+            if (!file) {
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+        std::rename(temp_path.c_str(), path.c_str()); // Readers see the old or the new manifest, whole
+    }
+
+    // nullopt when a delta would not be worth it: with less than a tenth of
+    // the buffer in common with the base, the manifest only adds bytes.
+    static std::optional<BatchRequest> deltaRequest(const BatchRequest& request, const Manifest& base,
+                                                    const Manifest& current, std::string_view content) {
+        std::unordered_map<uint64_t, const ContentChunker::Chunk*> known;
+        known.reserve(base.chunks.size());
+        for (const auto& chunk : base.chunks) known.emplace(chunk.hash, &chunk);
+
+        // Ops as (is_copy, offset, length); neighbouring ops of a kind merge
+        struct Op {
+            bool copy;
+            size_t offset;
+            size_t length;
+        };
+        std::vector<Op> ops;
+        size_t literal_bytes = 0;
+        for (const auto& chunk : current.chunks) {
+            auto match = known.find(chunk.hash);
+            bool copy = match != known.end() && match->second->length == chunk.length;
+            size_t offset = copy ? match->second->offset : chunk.offset;
+            if (!copy) literal_bytes += chunk.length;
+            if (!ops.empty() && ops.back().copy == copy && ops.back().offset + ops.back().length == offset) {
+                ops.back().length += chunk.length;
+            } else {
+                ops.push_back({copy, offset, chunk.length});
+            }
+        }
+        if (literal_bytes * 10 > content.size() * 9) return std::nullopt; // Mostly new: just send it
+
+        std::string content_type = "application/octet-stream";
+        for (const auto& header : request.headers) {
+            if (header.size() > 13 && strncasecmp(header.c_str(), "content-type:", 13) == 0) {
+                content_type = header.substr(header.find_first_not_of(' ', 13));
+            }
+        }
+
+        std::string manifest = "{\"base\":\"" + base.sha256 + "\",\"target\":\"" + current.sha256 +
+                               "\",\"size\":" + std::to_string(current.size) +
+                               ",\"content_type\":" + RequestSample::quote(content_type) + ",\"ops\":[";
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (i) manifest += ',';
+            manifest += ops[i].copy
+                ? "[\"c\"," + std::to_string(ops[i].offset) + "," + std::to_string(ops[i].length) + "]"
+                : "[\"l\"," + std::to_string(ops[i].length) + "]";
+        }
+        manifest += "]}\n";
+
+        BatchRequest delta = request;
+        delta.body_file.reset();
+        delta.body.reserve(manifest.size() + literal_bytes);
+        delta.body = std::move(manifest);
+        for (const auto& op : ops) {
+            if (!op.copy) delta.body.append(content.data() + op.offset, op.length);
+        }
+        delta.headers.clear();
+        for (const auto& header : request.headers) {
+            if (strncasecmp(header.c_str(), "content-type:", 13) != 0) delta.headers.push_back(header);
+        }
+        delta.headers.push_back("Content-Type: application/x-buffer-delta");
+        delta.headers.push_back("X-Buffer-Sync: 1");
+        return delta;
+    }
+
+    // The answers that mean "this server can't (or can no longer) apply it".
+    static bool needsFullUpload(const BatchResult& result) {
+        switch (result.status) {
+            case 400: case 404: case 405: case 409: case 415: case 422: case 501: return true;
+            default: return false;
+        }
+    }
+
+    static std::string storedHash(const BatchResult& result) {
+        std::string value = result.header("x-buffer-sync");
+        size_t at = value.find("stored=");
+        return at == std::string::npos ? "" : value.substr(at + 7, 64);
+    }
+};
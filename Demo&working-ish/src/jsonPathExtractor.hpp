@@ -0,0 +1,363 @@
+#pragma once
+
+// Pulls a handful of values out of a JSON document without building a DOM.
+//
+// Give it JSON-pointer paths ("/candidates/0/content/parts/0/text") and feed
+// it the document in whatever pieces the network delivers; it tracks where it
+// is with a small container stack and only copies bytes that belong to a
+// requested value. String values come back decoded; any other value comes
+// back as its raw JSON text. Once every path has been found the rest of the
+// input is skipped without being looked at.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+
+class JsonPathExtractor {
+public:
+    struct Result {
+        bool found = false;
+        bool is_string = false;
+        std::string value;
+    };
+
+    explicit JsonPathExtractor(const std::vector<std::string>& pointers) {
+        for (const auto& pointer : pointers) {
+            Target target;
+            target.tokens = splitPointer(pointer);
+            targets_.push_back(std::move(target));
+        }
+        remaining_ = targets_.size();
+    }
+
+    void feed(std::string_view chunk) {
+        for (char c : chunk) {
+            if (remaining_ == 0 || state_ == State::Done) return;
+            step(c);
+            ++offset_;
+        }
+    }
+
+    // Call after the last chunk. Throws if the document was cut short.
+    void finish() {
+        if (remaining_ == 0) return;
+        if (state_ == State::Literal) endLiteral();
+        if (state_ != State::Done) {
+            fail("unexpected end of input");
+        }
+    }
+
+    bool complete() const { return remaining_ == 0; }
+    bool found(size_t i) const { return targets_.at(i).found; }
+    bool isString(size_t i) const { return targets_.at(i).is_string; }
+    const std::string& value(size_t i) const { return targets_.at(i).value; }
+
+    // One-shot helper for bodies that are already in memory.
+    static std::vector<JsonPathExtractor::Result> extract(std::string_view document,
+                                                          const std::vector<std::string>& pointers);
+
+private:
+    enum class State { Value, KeyOrEnd, Key, Colon, CommaOrEnd, String, Escape, Unicode, Literal, Done };
+
+    struct Frame {
+        bool is_object = false;
+        size_t index = 0;   // Next element index (arrays)
+        std::string key;    // Current member name (objects)
+    };
+
+    struct Target {
+        std::vector<std::string> tokens;
+        bool found = false;
+        bool is_string = false;
+        size_t depth = 0;   // Stack depth at which its value started
+        std::string value;
+    };
+
+    std::vector<Target> targets_;
+    size_t remaining_ = 0;
+    std::vector<Frame> stack_;
+    State state_ = State::Value;
+    bool string_is_key_ = false;
+    std::string string_buffer_;   // Decoded key, or decoded captured string
+    uint32_t unicode_ = 0;
+    int unicode_digits_ = 0;
+    uint32_t high_surrogate_ = 0;
+    std::vector<size_t> active_;  // Targets whose value is being read right now
+    bool decoding_value_ = false; // The current string value is a target
+    size_t offset_ = 0;
+
+    static std::vector<std::string> splitPointer(const std::string& pointer) {
+        std::vector<std::string> tokens;
+        if (pointer.empty()) return tokens;
+        if (pointer[0] != '/') throw std::runtime_error("Invalid JSON pointer: " + pointer);
+        std::string token;
+        for (size_t i = 1; i <= pointer.size(); ++i) {
+            if (i == pointer.size() || pointer[i] == '/') {
+                tokens.push_back(token);
+                token.clear();
+            } else if (pointer[i] == '~' && i + 1 < pointer.size() && (pointer[i + 1] == '0' || pointer[i + 1] == '1')) {
+                token += pointer[++i] == '0' ? '~' : '/';
+            } else {
+                token += pointer[i];
+            }
+        }
+        return tokens;
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("JSON parse error at byte " + std::to_string(offset_) + ": " + what);
+    }
+
+    // Does the path of the value about to start equal target t?
+    bool pathMatches(const Target& t) const {
+        if (t.tokens.size() != stack_.size()) return false;
+        for (size_t i = 0; i < stack_.size(); ++i) {
+            const Frame& frame = stack_[i];
+            if (frame.is_object) {
+                if (frame.key != t.tokens[i]) return false;
+            } else if (std::to_string(frame.index) != t.tokens[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Targets may nest ("/usage" and "/usage/total"), so several can be
+    // active at once; each records raw bytes until its own value closes.
+    void beginValue(char c) {
+        for (size_t i = 0; i < targets_.size(); ++i) {
+            Target& target = targets_[i];
+            if (target.found || !pathMatches(target)) continue;
+            target.is_string = c == '"';
+            target.depth = stack_.size();
+            target.value.clear();
+            active_.push_back(i);
+            if (target.is_string) decoding_value_ = true;
+        }
+    }
+
+    void endValue() {
+        for (size_t a = 0; a < active_.size();) {
+            Target& target = targets_[active_[a]];
+            if (target.depth != stack_.size()) {
+                ++a;
+                continue;
+            }
+            if (target.is_string) target.value = string_buffer_;
+            target.found = true;
+            --remaining_;
+            active_.erase(active_.begin() + (long)a);
+        }
+        decoding_value_ = false;
+        state_ = stack_.empty() ? State::Done : State::CommaOrEnd;
+    }
+
+    void endLiteral() {
+        endValue();
+    }
+
+    void appendUtf8(uint32_t cp) {
+        if (cp < 0x80) {
+            string_buffer_ += (char)cp;
+        } else if (cp < 0x800) {
+            string_buffer_ += (char)(0xC0 | (cp >> 6));
+            string_buffer_ += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            string_buffer_ += (char)(0xE0 | (cp >> 12));
+            string_buffer_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            string_buffer_ += (char)(0x80 | (cp & 0x3F));
+        } else {
+            string_buffer_ += (char)(0xF0 | (cp >> 18));
+            string_buffer_ += (char)(0x80 | ((cp >> 12) & 0x3F));
+            string_buffer_ += (char)(0x80 | ((cp >> 6) & 0x3F));
+            string_buffer_ += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // Keys are always decoded (to match against tokens); string values only
+    // when they are being captured.
+    bool decodingString() const {
+        return string_is_key_ || decoding_value_;
+    }
+
+    void rawCapture(char c) {
+        for (size_t i : active_) {
+            if (!targets_[i].is_string) targets_[i].value += c;
+        }
+    }
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    void step(char c) {
+        switch (state_) {
+            case State::String:
+                if (c == '"') {
+                    rawCapture(c);
+                    if (string_is_key_) {
+                        stack_.back().key = std::move(string_buffer_);
+                        string_buffer_.clear();
+                        string_is_key_ = false;
+                        state_ = State::Colon;
+                    } else {
+                        endValue();
+                    }
+                } else if (c == '\\') {
+                    rawCapture(c);
+                    state_ = State::Escape;
+                } else {
+                    rawCapture(c);
+                    if (decodingString()) string_buffer_ += c;
+                }
+                return;
+
+            case State::Escape: {
+                rawCapture(c);
+                state_ = State::String;
+                if (c == 'u') {
+                    unicode_ = 0;
+                    unicode_digits_ = 0;
+                    state_ = State::Unicode;
+                    return;
+                }
+                char decoded;
+                switch (c) {
+                    case '"': decoded = '"'; break;
+                    case '\\': decoded = '\\'; break;
+                    case '/': decoded = '/'; break;
+                    case 'b': decoded = '\b'; break;
+                    case 'f': decoded = '\f'; break;
+                    case 'n': decoded = '\n'; break;
+                    case 'r': decoded = '\r'; break;
+                    case 't': decoded = '\t'; break;
+                    default: fail(std::string("invalid escape \\") + c);
+                }
+                if (decodingString()) string_buffer_ += decoded;
+                return;
+            }
+
+            case State::Unicode: {
+                rawCapture(c);
+                int digit = (c >= '0' && c <= '9') ? c - '0'
+                          : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                          : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (digit < 0) fail("invalid \\u escape");
+                unicode_ = (unicode_ << 4) | (uint32_t)digit;
+                if (++unicode_digits_ < 4) return;
+                state_ = State::String;
+                if (!decodingString()) return;
+                if (unicode_ >= 0xD800 && unicode_ <= 0xDBFF) {
+                    high_surrogate_ = unicode_;
+                } else if (unicode_ >= 0xDC00 && unicode_ <= 0xDFFF && high_surrogate_) {
+                    appendUtf8(0x10000 + ((high_surrogate_ - 0xD800) << 10) + (unicode_ - 0xDC00));
+                    high_surrogate_ = 0;
+                } else {
+                    appendUtf8(unicode_);
+                    high_surrogate_ = 0;
+                }
+                return;
+            }
+
+            case State::Literal:
+                if (c == ',' || c == '}' || c == ']' || isSpace(c)) {
+                    endLiteral();
+                    step(c); // The delimiter belongs to the enclosing container
+                } else {
+                    rawCapture(c);
+                }
+                return;
+
+            case State::Value:
+                if (isSpace(c)) return;
+                if (c == ']' && !stack_.empty() && !stack_.back().is_object && stack_.back().index == 0) {
+                    rawCapture(c);
+                    closeContainer(c); // Empty array
+                    return;
+                }
+                beginValue(c);
+                rawCapture(c);
+                if (c == '{') {
+                    stack_.emplace_back();
+                    stack_.back().is_object = true;
+                    state_ = State::KeyOrEnd;
+                } else if (c == '[') {
+                    stack_.emplace_back();
+                    state_ = State::Value;
+                } else if (c == '"') {
+                    string_buffer_.clear();
+                    string_is_key_ = false;
+                    state_ = State::String;
+                } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                    state_ = State::Literal;
+                } else {
+                    fail(std::string("unexpected '") + c + "'");
+                }
+                return;
+
+            case State::KeyOrEnd:
+            case State::Key:
+                if (isSpace(c)) return;
+                rawCapture(c);
+                if (c == '"') {
+                    string_buffer_.clear();
+                    string_is_key_ = true;
+                    state_ = State::String;
+                } else if (c == '}' && state_ == State::KeyOrEnd) {
+                    closeContainer(c);
+                } else {
+                    fail("expected object key");
+                }
+                return;
+
+            case State::Colon:
+                if (isSpace(c)) return;
+                rawCapture(c);
+                if (c != ':') fail("expected ':'");
+                state_ = State::Value;
+                return;
+
+            case State::CommaOrEnd:
+                if (isSpace(c)) return;
+                if (c == ',') {
+                    rawCapture(c);
+                    Frame& frame = stack_.back();
+                    if (frame.is_object) {
+                        state_ = State::Key;
+                    } else {
+                        ++frame.index;
+                        state_ = State::Value;
+                    }
+                } else if (c == '}' || c == ']') {
+                    rawCapture(c);
+                    closeContainer(c);
+                } else {
+                    fail("expected ',' or end of container");
+                }
+                return;
+
+            case State::Done:
+                return;
+        }
+    }
+
+    void closeContainer(char c) {
+        if (stack_.empty() || stack_.back().is_object != (c == '}')) fail("mismatched bracket");
+        stack_.pop_back();
+        endValue();
+    }
+};
+
+inline std::vector<JsonPathExtractor::Result> JsonPathExtractor::extract(std::string_view document,
+                                                                         const std::vector<std::string>& pointers) {
+    JsonPathExtractor extractor(pointers);
+    extractor.feed(document);
+    extractor.finish();
+    std::vector<Result> results(pointers.size());
+    for (size_t i = 0; i < pointers.size(); ++i) {
+        results[i].found = extractor.found(i);
+        results[i].is_string = extractor.isString(i);
+        results[i].value = extractor.value(i);
+    }
+    return results;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Read-only memory mapping of a whole file.
+//
+// Used for request bodies: the kernel pages the file in as curl's read
+// callback walks through it, so a multi-megabyte upload never exists as a
+// std::string copy in our heap. Empty files are represented without a
+// mapping (mmap() refuses zero-length maps).
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Cannot open file: " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat file: " + path);
+        }
+        size_ = (size_t)st.st_size;
+        if (size_ > 0) {
+            void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map file: " + path);
+            }
+            data_ = static_cast<const char*>(mapping);
+            madvise(mapping, size_, MADV_SEQUENTIAL); // Read once, front to back
+        }
+        ::close(fd); // The mapping keeps the file alive
+    }
+
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : path_(std::move(other.path_)), data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)) {}
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    const std::string& path() const { return path_; }
+    const char* data() const { return data_ ? data_ : ""; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data(), size_); }
+
+private:
+    std::string path_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
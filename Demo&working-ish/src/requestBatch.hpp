@@ -0,0 +1,391 @@
+#pragma once
+
+// Runs many HTTP requests at once on one curl multi handle.
+//
+// Requests to the same host share a single HTTP/2 connection where the server
+// negotiates it (CURLPIPE_MULTIPLEX + CURLOPT_PIPEWAIT on https), and at most
+// max_concurrency transfers are in flight at any moment. Results always come
+// back in input order, whatever order the transfers finish in. A RequestBatch
+// can be reused for several run() calls; its connections and easy handles
+// stay warm in between.
+//
+// Failed transfers are retried according to a RetryPolicy. A request that is
+// backing off sits on a timer queue and gives its concurrency slot to the
+// next request, so one struggling request never stalls the rest.
+//
+// Compressed replies are always accepted and decoded before they reach the
+// body, sink or on_data. Request bodies are compressed when the request asks
+// for it (see bodyCompression.hpp); file bodies are compressed as they are
+// uploaded.
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <functional>
+#include <cctype>
+#include <strings.h>
+#include <curl/curl.h>
+#include "retryPolicy.hpp"
+#include "mappedFile.hpp"
+#include "responseSink.hpp"
+#include "requestMetrics.hpp"
+#include "bodyCompression.hpp"
+
+struct BatchRequest {
+    std::string url;
+    std::string method = "POST";
+    std::vector<std::string> headers; // "Name: value"
+    std::string body;
+    // When set, the body is streamed straight out of this mapping through a
+    // read callback and `body` is ignored.
+    std::shared_ptr<const MappedFile> body_file;
+    // When set, the response body is written here as it arrives instead of
+    // being collected in BatchResult::body. Not owned; must outlive run().
+    ResponseSink* sink = nullptr;
+    // When set (and there is no sink), 2xx response bodies are handed to this
+    // chunk by chunk instead of being collected; error bodies are still
+    // collected so they can be reported. Throwing aborts the transfer.
+    std::function<void(const char*, size_t)> on_data;
+    // Content-Encoding for the body, applied when it is large enough.
+    // Defaults to none; callers usually pass RequestCompression::process().
+    RequestCompression compression;
+};
+
+struct BatchResult {
+    long status = 0;    // HTTP status, 0 if the transfer itself failed
+    std::string body;   // Empty when the request had a sink
+    std::string error;  // Transport error; empty when a response arrived
+    int attempts = 0;   // 1 + number of retries it took
+    // Headers of the final response, names lowercased
+    std::vector<std::pair<std::string, std::string>> headers;
+
+    // Value of the first header called `name` (lowercase), or "".
+    std::string header(const std::string& name) const {
+        for (const auto& entry : headers) {
+            if (entry.first == name) return entry.second;
+        }
+        return "";
+    }
+};
+
+class RequestBatch {
+public:
+    explicit RequestBatch(size_t max_concurrency = 8, RetryPolicy retry = RetryPolicy())
+        : max_concurrency_(max_concurrency ? max_concurrency : 1), retry_(retry) {
+        multi_ = curl_multi_init();
+        if (!multi_) {
+            throw std::runtime_error("Failed to initialize libcurl multi handle.");
+        }
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(multi_, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)max_concurrency_);
+    }
+
+    ~RequestBatch() {
+        for (CURL* easy : idle_) curl_easy_cleanup(easy);
+        curl_multi_cleanup(multi_);
+    }
+
+    RequestBatch(const RequestBatch&) = delete;
+    RequestBatch& operator=(const RequestBatch&) = delete;
+
+    std::vector<BatchResult> run(const std::vector<BatchRequest>& requests) {
+        using Clock = std::chrono::steady_clock;
+        struct Backoff {
+            Clock::time_point due;
+            size_t index;
+            bool operator>(const Backoff& other) const { return due > other.due; }
+        };
+
+        std::vector<BatchResult> results(requests.size());
+        std::vector<std::unique_ptr<Transfer>> live;
+        std::priority_queue<Backoff, std::vector<Backoff>, std::greater<Backoff>> waiting;
+        size_t next = 0;
+
+        while (next < requests.size() || !live.empty() || !waiting.empty()) {
+            // Due retries go first, then fresh requests, up to the cap
+            Clock::time_point now = Clock::now();
+            while (live.size() < max_concurrency_ && !waiting.empty() && waiting.top().due <= now) {
+                size_t index = waiting.top().index;
+                waiting.pop();
+                live.push_back(start(requests[index], index, results[index].attempts + 1));
+            }
+            while (live.size() < max_concurrency_ && next < requests.size()) {
+                live.push_back(start(requests[next], next, 1));
+                ++next;
+            }
+
+            int still_running = 0;
+            CURLMcode mc = curl_multi_perform(multi_, &still_running);
+            if (mc != CURLM_OK) {
+                throw std::runtime_error("curl_multi_perform() failed: " + std::string(curl_multi_strerror(mc)));
+            }
+
+            int queued = 0;
+            while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                Transfer* transfer = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&transfer);
+
+                std::chrono::milliseconds delay{0};
+                if (finish(*transfer, msg->data.result, results[transfer->index], delay)) {
+                    waiting.push({Clock::now() + delay, transfer->index});
+                }
+                live.erase(std::find_if(live.begin(), live.end(),
+                                        [transfer](const std::unique_ptr<Transfer>& t) { return t.get() == transfer; }));
+            }
+
+            // Sleep until there is socket activity or the next retry falls due.
+            // curl_multi_poll() waits out the timeout even with no transfers.
+            long timeout_ms = 1000;
+            if (!waiting.empty()) {
+                auto until_due = std::chrono::duration_cast<std::chrono::milliseconds>(waiting.top().due - Clock::now());
+                timeout_ms = std::max(0L, std::min<long>(timeout_ms, (long)until_due.count()));
+            }
+            if (!live.empty() || (!waiting.empty() && timeout_ms > 0)) {
+                curl_multi_poll(multi_, nullptr, 0, (int)timeout_ms, nullptr);
+            }
+        }
+        return results;
+    }
+
+private:
+    struct Transfer {
+        size_t index = 0;
+        int attempt = 1;
+        const std::string* url = nullptr;
+        CURL* easy = nullptr;
+        curl_slist* headers = nullptr;
+        std::string response;
+        std::string retry_after; // Retry-After header of the final response
+        std::vector<std::pair<std::string, std::string>> response_headers;
+        const MappedFile* upload = nullptr;
+        size_t upload_offset = 0;
+        std::unique_ptr<BodyCompressor> compressor; // Set when the upload is compressed on the fly
+        std::string compressed_body;                // In-memory bodies, compressed once up front
+        ResponseSink* sink = nullptr;
+        const std::function<void(const char*, size_t)>* on_data = nullptr;
+        bool delivered = false; // on_data has seen bytes; it can't be rewound
+        std::string sink_error;   // Also set when producing the upload failed
+
+        ~Transfer() {
+            if (headers) curl_slist_free_all(headers);
+        }
+    };
+
+    CURLM* multi_ = nullptr;
+    std::vector<CURL*> idle_;
+    size_t max_concurrency_;
+    RetryPolicy retry_;
+
+    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+        Transfer& transfer = *static_cast<Transfer*>(userp);
+        if (!transfer.sink && transfer.on_data) {
+            long status = 0;
+            curl_easy_getinfo(transfer.easy, CURLINFO_RESPONSE_CODE, &status);
+            if (status >= 300) {
+                transfer.response.append((char*)contents, size * nmemb);
+                return size * nmemb;
+            }
+        } else if (!transfer.sink) {
+            transfer.response.append((char*)contents, size * nmemb);
+            return size * nmemb;
+        }
+        try {
+            if (transfer.sink) {
+                transfer.sink->write((char*)contents, size * nmemb);
+            } else {
+                transfer.delivered = true;
+                (*transfer.on_data)((char*)contents, size * nmemb);
+            }
+        } catch (const std::exception& e) {
+            transfer.sink_error = e.what();
+            return 0; // Aborts the transfer with CURLE_WRITE_ERROR
+        }
+        return size * nmemb;
+    }
+
+    static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+        Transfer& transfer = *static_cast<Transfer*>(userp);
+        size_t bytes = size * nitems;
+        std::string line(buffer, bytes);
+        if (line.compare(0, 5, "HTTP/") == 0) {
+            transfer.retry_after.clear(); // New response (redirect, 100-continue): forget the old one
+            transfer.response_headers.clear();
+            return bytes;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) return bytes;
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        size_t begin = line.find_first_not_of(" \t", colon + 1);
+        size_t end = line.find_last_not_of(" \t\r\n");
+        std::string value = begin != std::string::npos && end >= begin ? line.substr(begin, end - begin + 1) : "";
+        if (name == "retry-after") transfer.retry_after = value;
+        transfer.response_headers.emplace_back(std::move(name), std::move(value));
+        return bytes;
+    }
+
+    // Feeds curl from the mapped body file, one upload buffer at a time.
+    static size_t ReadCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+        Transfer& transfer = *static_cast<Transfer*>(userp);
+        if (transfer.compressor) {
+            try {
+                return transfer.compressor->read(buffer, size * nitems);
+            } catch (const std::exception& e) {
+                transfer.sink_error = e.what();
+                return CURL_READFUNC_ABORT;
+            }
+        }
+        size_t count = std::min(size * nitems, transfer.upload->size() - transfer.upload_offset);
+        std::memcpy(buffer, transfer.upload->data() + transfer.upload_offset, count);
+        transfer.upload_offset += count;
+        return count;
+    }
+
+    // Lets curl rewind the body, e.g. to resend it after a redirect.
+    static int SeekCallback(void* userp, curl_off_t offset, int origin) {
+        Transfer& transfer = *static_cast<Transfer*>(userp);
+        if (transfer.compressor) {
+            // A compressed stream can only start over
+            if (origin != SEEK_SET || offset != 0) return CURL_SEEKFUNC_CANTSEEK;
+            transfer.compressor->restart();
+            return CURL_SEEKFUNC_OK;
+        }
+        if (origin != SEEK_SET || offset < 0 || (size_t)offset > transfer.upload->size()) {
+            return CURL_SEEKFUNC_CANTSEEK;
+        }
+        transfer.upload_offset = (size_t)offset;
+        return CURL_SEEKFUNC_OK;
+    }
+
+    std::unique_ptr<Transfer> start(const BatchRequest& request, size_t index, int attempt) {
+        auto transfer = std::make_unique<Transfer>();
+        transfer->index = index;
+        transfer->attempt = attempt;
+        transfer->url = &request.url;
+        transfer->sink = request.sink;
+        if (request.on_data) transfer->on_data = &request.on_data;
+        if (attempt == 1) RetryBudget::process().recordAttempt();
+
+        if (!idle_.empty()) {
+            transfer->easy = idle_.back();
+            idle_.pop_back();
+            curl_easy_reset(transfer->easy);
+        } else {
+            transfer->easy = curl_easy_init();
+            if (!transfer->easy) {
+                throw std::runtime_error("Failed to initialize libcurl.");
+            }
+        }
+
+        for (const auto& header : request.headers) {
+            transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+        }
+        if (request.body_file) {
+            // Skip the 100-continue round trip; we are sending the body regardless
+            transfer->headers = curl_slist_append(transfer->headers, "Expect:");
+        }
+        size_t body_size = request.body_file ? request.body_file->size() : request.body.size();
+        bool compress = request.compression.appliesTo(body_size);
+        if (compress) {
+            std::string header = std::string("Content-Encoding: ") + request.compression.contentEncoding();
+            transfer->headers = curl_slist_append(transfer->headers, header.c_str());
+        }
+
+        CURL* easy = transfer->easy;
+        curl_easy_setopt(easy, CURLOPT_URL, request.url.c_str());
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer.get());
+        curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer.get());
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+        if (request.url.compare(0, 8, "https://") == 0) {
+            // Wait for ALPN to say whether the pending connection multiplexes
+            // rather than opening another. Plain http:// is always HTTP/1.1
+            // here, where waiting would only serialize the batch.
+            curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+        }
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, ""); // Whatever this curl can decode
+
+        if (request.body_file) {
+            transfer->upload = request.body_file.get();
+            curl_easy_setopt(easy, CURLOPT_POST, 1L);
+            if (request.method != "POST") {
+                curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+            }
+            if (compress) {
+                // Length unknown until the end: curl sends it chunked
+                transfer->compressor = std::make_unique<BodyCompressor>(request.compression, transfer->upload->view());
+            } else {
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)transfer->upload->size());
+            }
+            curl_easy_setopt(easy, CURLOPT_READFUNCTION, ReadCallback);
+            curl_easy_setopt(easy, CURLOPT_READDATA, transfer.get());
+            curl_easy_setopt(easy, CURLOPT_SEEKFUNCTION, SeekCallback);
+            curl_easy_setopt(easy, CURLOPT_SEEKDATA, transfer.get());
+        } else if (request.method == "GET") {
+            curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+        } else {
+            if (request.method != "POST") {
+                curl_easy_setopt(easy, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+            }
+            if (compress) {
+                transfer->compressed_body = request.compression.compress(request.body);
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, (long)transfer->compressed_body.size());
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->compressed_body.c_str());
+            } else if (request.method == "POST" || !request.body.empty()) {
+                // The request vector outlives the transfer, so no copy is needed
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, (long)request.body.size());
+                curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request.body.c_str());
+            }
+        }
+
+        curl_multi_add_handle(multi_, easy);
+        return transfer;
+    }
+
+    // Records the outcome in result, or returns true with the backoff delay
+    // when the request should be tried again.
+    bool finish(Transfer& transfer, CURLcode code, BatchResult& result, std::chrono::milliseconds& delay) {
+        long status = 0;
+        if (code == CURLE_OK) {
+            curl_easy_getinfo(transfer.easy, CURLINFO_RESPONSE_CODE, &status);
+        }
+        RequestSample sample = RequestSample::fromCurl(transfer.easy, *transfer.url, code);
+        curl_multi_remove_handle(multi_, transfer.easy);
+        idle_.push_back(transfer.easy);
+        transfer.easy = nullptr;
+
+        result.attempts = transfer.attempt;
+        if (retry_.shouldRetry(transfer.attempt, status, code, transfer.retry_after, delay)) {
+            // A retry has to start from an empty sink; a pipe can't be
+            // unwritten, and neither can bytes on_data has already consumed
+            if (!transfer.delivered && (!transfer.sink || transfer.sink->rewind())) return true;
+        }
+        sample.retries = transfer.attempt - 1; // Timings are those of the last attempt
+        RequestMetrics::process().record(sample);
+
+        if (code == CURLE_OK) {
+            result.status = status;
+            result.body = std::move(transfer.response);
+            result.headers = std::move(transfer.response_headers);
+            result.error.clear();
+        } else {
+            result.status = 0;
+            result.body.clear();
+            result.error = transfer.sink_error.empty()
+                ? "curl transfer failed: " + std::string(curl_easy_strerror(code))
+                : transfer.sink_error;
+        }
+        return false;
+    }
+};
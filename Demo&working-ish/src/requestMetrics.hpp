@@ -0,0 +1,288 @@
+#pragma once
+
+// Where the time of each request went, and aggregates of it.
+//
+// Every finished request (or cache hit) becomes one RequestSample: curl's
+// phase timings turned into durations (dns, connect, tls, server, transfer,
+// total), body bytes each way, retries, cache hit, status. RequestMetrics
+// folds samples into per-endpoint log-linear histograms, HDR style: exact up
+// to 128 us, then 64 buckets per power of two, so any percentile is within
+// ~1.6% of the true value while a histogram stays a fixed few KiB. Samples
+// can also be appended as JSON lines to a metrics file (API_METRICS_FILE),
+// one write() per line, so several processes can share one file.
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+class LatencyHistogram {
+public:
+    void record(int64_t micros) {
+        uint64_t value = micros < 0 ? 0 : (uint64_t)micros;
+        size_t index = bucketFor(value);
+        if (index >= counts_.size()) counts_.resize(index + 1, 0);
+        ++counts_[index];
+        if (count_ == 0 || value < min_) min_ = value;
+        max_ = std::max(max_, value);
+        sum_ += value;
+        ++count_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return min_; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? (double)sum_ / (double)count_ : 0.0; }
+
+    // Value at quantile q (0..1), as the middle of the bucket holding it.
+    uint64_t percentile(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = (uint64_t)(q * (double)count_ + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t middle = lowerBound(i) + (lowerBound(i + 1) - lowerBound(i)) / 2;
+                return std::clamp(middle, min_, max_);
+            }
+        }
+        return max_;
+    }
+
+    // {"count":n,"min_ms":..,"p50_ms":..,"p90_ms":..,"p99_ms":..,"max_ms":..,"mean_ms":..}
+    std::string json() const {
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer),
+                      "{\"count\":%llu,\"min_ms\":%.3f,\"p50_ms\":%.3f,\"p90_ms\":%.3f,"
+                      "\"p99_ms\":%.3f,\"max_ms\":%.3f,\"mean_ms\":%.3f}",
+                      (unsigned long long)count_, min_ / 1000.0, percentile(0.50) / 1000.0,
+                      percentile(0.90) / 1000.0, percentile(0.99) / 1000.0, max_ / 1000.0, mean() / 1000.0);
+        return buffer;
+    }
+
+private:
+    static constexpr unsigned kSubBits = 6;                 // 64 buckets per power of two
+    static constexpr uint64_t kLinear = 2ull << kSubBits;   // Exact below 128
+
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+    uint64_t sum_ = 0;
+
+    static size_t bucketFor(uint64_t value) {
+        if (value < kLinear) return (size_t)value;
+        unsigned shift = 63 - (unsigned)__builtin_clzll(value) - kSubBits;
+        return (size_t)(kLinear + (shift - 1) * (kLinear / 2) + ((value >> shift) - kLinear / 2));
+    }
+
+    static uint64_t lowerBound(size_t index) {
+        if (index < kLinear) return index;
+        size_t offset = index - kLinear;
+        unsigned shift = (unsigned)(offset / (kLinear / 2)) + 1;
+        return (kLinear / 2 + offset % (kLinear / 2)) << shift;
+    }
+};
+
+struct RequestSample {
+    std::string endpoint;   // URL without the query string (no API keys in logs)
+    long status = 0;        // HTTP status; 0 when the transfer failed
+    bool error = false;     // Transport error or HTTP >= 400
+    bool cache_hit = false;
+    int retries = 0;
+    int64_t bytes_in = 0;   // Response body bytes
+    int64_t bytes_out = 0;  // Request body bytes
+    // Phase durations in microseconds; -1 when unknown (e.g. cache hits)
+    int64_t dns_us = -1;       // Name lookup
+    int64_t connect_us = -1;   // TCP connect
+    int64_t tls_us = -1;       // TLS handshake (0 for plain HTTP)
+    int64_t server_us = -1;    // Request sent -> first response byte
+    int64_t transfer_us = -1;  // First -> last response byte
+    int64_t total_us = -1;
+
+    static std::string stripQuery(const std::string& url) {
+        return url.substr(0, url.find('?'));
+    }
+
+    // Reads the timings of the transfer that just finished on `easy`.
+    static RequestSample fromCurl(CURL* easy, const std::string& url, CURLcode code) {
+        RequestSample sample;
+        sample.endpoint = stripQuery(url);
+        if (code == CURLE_OK) curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &sample.status);
+        sample.error = code != CURLE_OK || sample.status >= 400;
+
+        curl_off_t lookup = 0, connect = 0, app = 0, pre = 0, start = 0, total = 0, down = 0, up = 0;
+        curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+        curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect);
+        curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &app);
+        curl_easy_getinfo(easy, CURLINFO_PRETRANSFER_TIME_T, &pre);
+        curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &start);
+        curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+        curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &down);
+        curl_easy_getinfo(easy, CURLINFO_SIZE_UPLOAD_T, &up);
+
+        // curl reports each phase as "time since start"; turn them into durations.
+        // A reused connection reports 0 for lookup/connect/appconnect.
+        connect = std::max(connect, lookup);
+        app = app > 0 ? std::max(app, connect) : connect;
+        pre = std::max(pre, app);
+        start = start > 0 ? std::max(start, pre) : total;
+        sample.dns_us = lookup;
+        sample.connect_us = connect - lookup;
+        sample.tls_us = app - connect;
+        sample.server_us = start - pre;
+        sample.transfer_us = std::max<curl_off_t>(0, total - start);
+        sample.total_us = total;
+        sample.bytes_in = down;
+        sample.bytes_out = up;
+        return sample;
+    }
+
+    // A request answered from the response cache in `elapsed`.
+    static RequestSample cacheHit(const std::string& url, std::chrono::steady_clock::duration elapsed,
+                                  size_t bytes) {
+        RequestSample sample;
+        sample.endpoint = stripQuery(url);
+        sample.status = 200;
+        sample.cache_hit = true;
+        sample.bytes_in = (int64_t)bytes;
+        sample.total_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        return sample;
+    }
+
+    std::string json() const {
+        char buffer[384];
+        std::snprintf(buffer, sizeof(buffer),
+                      ",\"status\":%ld,\"error\":%s,\"cache_hit\":%s,\"retries\":%d,\"bytes_in\":%lld,"
+                      "\"bytes_out\":%lld,\"dns_us\":%lld,\"connect_us\":%lld,\"tls_us\":%lld,"
+                      "\"server_us\":%lld,\"transfer_us\":%lld,\"total_us\":%lld}",
+                      status, error ? "true" : "false", cache_hit ? "true" : "false", retries,
+                      (long long)bytes_in, (long long)bytes_out, (long long)dns_us, (long long)connect_us,
+                      (long long)tls_us, (long long)server_us, (long long)transfer_us, (long long)total_us);
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return "{\"ts_ms\":" + std::to_string(now) + ",\"endpoint\":" + quote(endpoint) + buffer;
+    }
+
+    static std::string quote(const std::string& text) {
+        std::string out = "\"";
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            } else {
+                out += (char)c;
+            }
+        }
+        return out + "\"";
+    }
+};
+
+class RequestMetrics {
+public:
+    // Shared by every request path in the process. The metrics file comes
+    // from API_METRICS_FILE unless setMetricsFile() says otherwise.
+    static RequestMetrics& process() {
+        static RequestMetrics metrics(std::getenv("API_METRICS_FILE") ? std::getenv("API_METRICS_FILE") : "");
+        return metrics;
+    }
+
+    explicit RequestMetrics(const std::string& metrics_file = "") { setMetricsFile(metrics_file); }
+
+    ~RequestMetrics() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    RequestMetrics(const RequestMetrics&) = delete;
+    RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+    void setMetricsFile(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = path.empty() ? -1 : ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    void record(const RequestSample& sample) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        add(totals_, sample);
+        add(by_endpoint_[sample.endpoint], sample);
+        if (fd_ >= 0) {
+            std::string line = sample.json() + "\n";
+            if (::write(fd_, line.data(), line.size()) < 0) {
+                // Metrics are best effort; never fail a request over them
+            }
+        }
+    }
+
+    // {"all": {...}, "endpoints": {"<url>": {...}, ...}}
+    std::string summaryJson() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out = "{\"all\":" + aggregateJson(totals_) + ",\"endpoints\":{";
+        bool first = true;
+        for (const auto& [endpoint, aggregate] : by_endpoint_) {
+            out += (first ? "" : ",") + RequestSample::quote(endpoint) + ":" + aggregateJson(aggregate);
+            first = false;
+        }
+        return out + "}}";
+    }
+
+private:
+    struct Aggregate {
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        uint64_t cache_hits = 0;
+        uint64_t retries = 0;
+        int64_t bytes_in = 0;
+        int64_t bytes_out = 0;
+        LatencyHistogram dns, connect, tls, server, transfer, total;
+    };
+
+    mutable std::mutex mutex_;
+    Aggregate totals_;
+    std::map<std::string, Aggregate> by_endpoint_;
+    int fd_ = -1;
+
+    static void add(Aggregate& aggregate, const RequestSample& sample) {
+        ++aggregate.requests;
+        aggregate.errors += sample.error ? 1 : 0;
+        aggregate.cache_hits += sample.cache_hit ? 1 : 0;
+        aggregate.retries += (uint64_t)sample.retries;
+        aggregate.bytes_in += sample.bytes_in;
+        aggregate.bytes_out += sample.bytes_out;
+        if (sample.total_us >= 0) aggregate.total.record(sample.total_us);
+        if (sample.cache_hit) return; // Network phases only describe network requests
+        if (sample.dns_us >= 0) aggregate.dns.record(sample.dns_us);
+        if (sample.connect_us >= 0) aggregate.connect.record(sample.connect_us);
+        if (sample.tls_us >= 0) aggregate.tls.record(sample.tls_us);
+        if (sample.server_us >= 0) aggregate.server.record(sample.server_us);
+        if (sample.transfer_us >= 0) aggregate.transfer.record(sample.transfer_us);
+    }
+
+    static std::string aggregateJson(const Aggregate& a) {
+        return "{\"requests\":" + std::to_string(a.requests) +
+               ",\"errors\":" + std::to_string(a.errors) +
+               ",\"cache_hits\":" + std::to_string(a.cache_hits) +
+               ",\"retries\":" + std::to_string(a.retries) +
+               ",\"bytes_in\":" + std::to_string(a.bytes_in) +
+               ",\"bytes_out\":" + std::to_string(a.bytes_out) +
+               ",\"dns\":" + a.dns.json() +
+               ",\"connect\":" + a.connect.json() +
+               ",\"tls\":" + a.tls.json() +
+               ",\"server\":" + a.server.json() +
+               ",\"transfer\":" + a.transfer.json() +
+               ",\"total\":" + a.total.json() + "}";
+    }
+};
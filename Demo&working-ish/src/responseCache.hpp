@@ -0,0 +1,323 @@
+#pragma once
+
+// Persistent, content-addressed response cache shared by every helper binary.
+//
+// Layout under the cache directory:
+//   index            fixed-size open-addressing table, mmap()ed MAP_SHARED
+//   objects/<hex>    one file per cached body, named by the 128-bit request key
+//
+// The index is guarded by flock() so several Vim instances can share one cache.
+// Entries carry an absolute expiry time and a logical "last used" clock; when
+// the total body size goes over the budget the least recently used entries are
+// evicted. Anything going wrong here only disables the cache, it never fails
+// the request that asked for it.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+class ResponseCache {
+public:
+    struct Key {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        std::string hex() const {
+            char buf[33];
+            std::snprintf(buf, sizeof(buf), "%016llx%016llx",
+                          (unsigned long long)hi, (unsigned long long)lo);
+            return buf;
+        }
+    };
+
+    struct Options {
+        std::string directory;
+        uint64_t max_bytes = 64ull << 20; // 64 MiB of bodies
+        int64_t ttl_seconds = 24 * 3600;  // 0 = never expire
+        uint32_t slot_count = 4096;
+        bool enabled = true;
+    };
+
+    // Defaults, overridable from the environment:
+    //   API_CACHE=0             bypass the cache entirely
+    //   API_CACHE_DIR           cache directory (default $XDG_CACHE_HOME/vimsBigHelper or ~/.cache/vimsBigHelper)
+    //   API_CACHE_MAX_BYTES     size budget for cached bodies
+    //   API_CACHE_TTL           entry lifetime in seconds
+    static Options defaultOptions() {
+        Options options;
+        if (const char* dir = std::getenv("API_CACHE_DIR")) {
+            options.directory = dir;
+        } else if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+            options.directory = std::string(xdg) + "/vimsBigHelper";
+        } else if (const char* home = std::getenv("HOME")) {
+            options.directory = std::string(home) + "/.cache/vimsBigHelper";
+        } else {
+            options.enabled = false;
+        }
+        if (const char* flag = std::getenv("API_CACHE")) {
+            std::string value = flag;
+            if (value == "0" || value == "off" || value == "false") options.enabled = false;
+        }
+        if (const char* bytes = std::getenv("API_CACHE_MAX_BYTES")) {
+            options.max_bytes = std::strtoull(bytes, nullptr, 10);
+        }
+        if (const char* ttl = std::getenv("API_CACHE_TTL")) {
+            options.ttl_seconds = std::strtoll(ttl, nullptr, 10);
+        }
+        return options;
+    }
+
+    // Builds the key from everything that decides what the server answers.
+    // Fields are length-prefixed so ("ab", "c") and ("a", "bc") never collide.
+    static Key makeKey(const std::string& endpoint,
+                       const std::string& method,
+                       const std::vector<std::pair<std::string, std::string>>& headers,
+                       std::string_view body) {
+        Key key;
+        key.hi = 0xcbf29ce484222325ull; // FNV-1a offset basis
+        key.lo = 0x84222325cbf29ce4ull; // Second, independent lane
+        auto mix = [&key](std::string_view field) {
+            const std::string length = std::to_string(field.size()) + ':';
+            for (std::string_view part : {std::string_view(length), field}) {
+                for (unsigned char c : part) {
+                    key.hi = (key.hi ^ c) * 0x100000001b3ull;
+                    key.lo = (key.lo ^ c) * 0x100000001b3ull;
+                    key.lo ^= key.lo >> 29;
+                }
+            }
+        };
+        mix(endpoint);
+        mix(method);
+        for (const auto& header : headers) {
+            mix(header.first);
+            mix(header.second);
+        }
+        mix(body);
+        return key;
+    }
+
+    explicit ResponseCache(Options options = defaultOptions()) : options_(std::move(options)) {
+        if (options_.enabled) open();
+    }
+
+    ~ResponseCache() {
+        if (index_) munmap(index_, mappedSize());
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    bool enabled() const { return index_ != nullptr; }
+
+    std::optional<std::string> lookup(const Key& key) {
+        if (!enabled()) return std::nullopt;
+        IndexLock lock(fd_);
+
+        Slot* slot = find(key);
+        if (!slot) return std::nullopt;
+        if (slot->expires_at != 0 && slot->expires_at <= (int64_t)std::time(nullptr)) {
+            remove(*slot);
+            return std::nullopt;
+        }
+
+        std::ifstream file(objectPath(key), std::ios::binary);
+        if (!file) {
+            remove(*slot); // Body vanished underneath us
+            return std::nullopt;
+        }
+        std::string body;
+        body.resize(slot->size);
+        file.read(&body[0], (std::streamsize)body.size());
+        if ((uint64_t)file.gcount() != slot->size) {
+            remove(*slot);
+            return std::nullopt;
+        }
+        slot->last_used = ++header()->clock;
+        return body;
+    }
+
+    void store(const Key& key, std::string_view body) {
+        if (!enabled() || body.size() > options_.max_bytes) return;
+
+        // Write the body first and rename it into place, so a reader that
+        // finds the index entry always sees a complete file.
+        std::string final_path = objectPath(key);
+        std::string temp_path = final_path + ".tmp." + std::to_string(::getpid());
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file) return;
+            file.write(body.data(), (std::streamsize)body.size());
+            if (!file) {
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+
+        IndexLock lock(fd_);
+        if (std::rename(temp_path.c_str(), final_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            return;
+        }
+
+        Slot* slot = find(key);
+        if (slot) {
+            header()->total_bytes -= slot->size;
+        } else {
+            // Keep the table at most 3/4 full so probe chains stay short
+            while (header()->used_slots >= header()->slot_count / 4 * 3) {
+                if (!evictOldest(nullptr)) break;
+            }
+            slot = freeSlotFor(key);
+            if (!slot) return;
+            slot->key_hi = key.hi;
+            slot->key_lo = key.lo;
+            slot->state = kUsed;
+            ++header()->used_slots;
+        }
+        slot->size = body.size();
+        slot->expires_at = options_.ttl_seconds > 0 ? (int64_t)std::time(nullptr) + options_.ttl_seconds : 0;
+        slot->last_used = ++header()->clock;
+        header()->total_bytes += slot->size;
+
+        while (header()->total_bytes > options_.max_bytes) {
+            if (!evictOldest(slot)) break;
+        }
+    }
+
+    void erase(const Key& key) {
+        if (!enabled()) return;
+        IndexLock lock(fd_);
+        if (Slot* slot = find(key)) remove(*slot);
+    }
+
+private:
+    static constexpr char kMagic[8] = {'V', 'B', 'H', 'C', 'A', 'C', 'H', 'E'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kEmpty = 0, kUsed = 1, kTombstone = 2;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t slot_count;
+        uint64_t total_bytes;
+        uint64_t used_slots;
+        uint64_t clock;
+    };
+
+    struct Slot {
+        uint64_t key_hi;
+        uint64_t key_lo;
+        int64_t expires_at;
+        uint64_t last_used;
+        uint64_t size;
+        uint32_t state;
+        uint32_t reserved;
+    };
+
+    struct IndexLock {
+        int fd;
+        explicit IndexLock(int f) : fd(f) { flock(fd, LOCK_EX); }
+        ~IndexLock() { flock(fd, LOCK_UN); }
+    };
+
+    Options options_;
+    int fd_ = -1;
+    void* index_ = nullptr;
+
+    size_t mappedSize() const { return sizeof(Header) + (size_t)options_.slot_count * sizeof(Slot); }
+    Header* header() { return static_cast<Header*>(index_); }
+    Slot* slots() { return reinterpret_cast<Slot*>(static_cast<char*>(index_) + sizeof(Header)); }
+
+    std::string objectPath(const Key& key) const { return options_.directory + "/objects/" + key.hex(); }
+
+    void open() {
+        if (options_.slot_count < 8) options_.slot_count = 8;
+        ::mkdir(options_.directory.c_str(), 0700);
+        ::mkdir((options_.directory + "/objects").c_str(), 0700);
+
+        fd_ = ::open((options_.directory + "/index").c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd_ < 0) return;
+
+        IndexLock lock(fd_);
+        struct stat st;
+        if (fstat(fd_, &st) != 0) return disable();
+        bool fresh = (size_t)st.st_size != mappedSize();
+        if (fresh && ftruncate(fd_, (off_t)mappedSize()) != 0) return disable();
+
+        index_ = mmap(nullptr, mappedSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (index_ == MAP_FAILED) {
+            index_ = nullptr;
+            return disable();
+        }
+
+        Header* h = header();
+        if (fresh || std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 ||
+            h->version != kVersion || h->slot_count != options_.slot_count) {
+            // New or incompatible index: start over. Orphaned object files are
+            // overwritten as their keys come back.
+            std::memset(index_, 0, mappedSize());
+            std::memcpy(h->magic, kMagic, sizeof(kMagic));
+            h->version = kVersion;
+            h->slot_count = options_.slot_count;
+        }
+    }
+
+    void disable() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    Slot* find(const Key& key) {
+        uint32_t count = header()->slot_count;
+        for (uint32_t i = 0, at = (uint32_t)(key.lo % count); i < count; ++i, at = (at + 1) % count) {
+            Slot& slot = slots()[at];
+            if (slot.state == kEmpty) return nullptr;
+            if (slot.state == kUsed && slot.key_hi == key.hi && slot.key_lo == key.lo) return &slot;
+        }
+        return nullptr;
+    }
+
+    Slot* freeSlotFor(const Key& key) {
+        uint32_t count = header()->slot_count;
+        for (uint32_t i = 0, at = (uint32_t)(key.lo % count); i < count; ++i, at = (at + 1) % count) {
+            if (slots()[at].state != kUsed) return &slots()[at];
+        }
+        return nullptr;
+    }
+
+    void remove(Slot& slot) {
+        std::remove(objectPath(Key{slot.key_hi, slot.key_lo}).c_str());
+        header()->total_bytes -= slot.size;
+        --header()->used_slots;
+        slot.state = kTombstone;
+        slot.size = 0;
+    }
+
+    // Drops the least recently used entry other than `keep`.
+    bool evictOldest(const Slot* keep) {
+        Slot* oldest = nullptr;
+        for (uint32_t i = 0; i < header()->slot_count; ++i) {
+            Slot& slot = slots()[i];
+            if (slot.state != kUsed || &slot == keep) continue;
+            if (!oldest || slot.last_used < oldest->last_used) oldest = &slot;
+        }
+        if (!oldest) return false;
+        remove(*oldest);
+        return true;
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+// Destination for a response body that is written while it downloads.
+//
+// File mode writes into a temporary file next to the final path and only
+// rename()s it into place after fsync(), so readers see either the old file
+// or the complete new one, never half a response. A sink that is destroyed
+// without commit() removes its temporary file.
+//
+// Descriptor mode writes straight into a caller-supplied fd (a pipe to Vim,
+// stdout, ...), so the reader can consume the body while it is still
+// arriving. The fd is not closed by the sink.
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+class ResponseSink {
+public:
+    explicit ResponseSink(const std::string& final_path) : path_(final_path) {
+        temp_path_ = final_path + ".XXXXXX";
+        fd_ = mkstemp(&temp_path_[0]);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot create temporary file for " + final_path + ": " + std::strerror(errno));
+        }
+        owns_fd_ = true;
+    }
+
+    explicit ResponseSink(int fd) : fd_(fd), owns_fd_(false) {}
+
+    ResponseSink(ResponseSink&& other) noexcept
+        : path_(std::move(other.path_)), temp_path_(std::move(other.temp_path_)),
+          fd_(std::exchange(other.fd_, -1)), owns_fd_(other.owns_fd_),
+          committed_(other.committed_), bytes_(other.bytes_) {}
+
+    ResponseSink(const ResponseSink&) = delete;
+    ResponseSink& operator=(const ResponseSink&) = delete;
+    ResponseSink& operator=(ResponseSink&&) = delete;
+
+    ~ResponseSink() {
+        if (owns_fd_ && fd_ >= 0) {
+            ::close(fd_);
+            if (!committed_) ::unlink(temp_path_.c_str());
+        }
+    }
+
+    // A name nobody else is using: <prefix>.<pid>-<ms since epoch>-<n><extension>
+    static std::string uniquePath(const std::string& prefix, const std::string& extension) {
+        static std::atomic<unsigned> counter{0};
+        auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return prefix + "." + std::to_string(::getpid()) + "-" + std::to_string(now) + "-" +
+               std::to_string(counter++) + extension;
+    }
+
+    // Directory for uniquePath() defaults: $TMPDIR or /tmp.
+    static std::string tempDirectory() {
+        const char* tmp = std::getenv("TMPDIR");
+        return tmp && *tmp ? tmp : "/tmp";
+    }
+
+    void write(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Write to response sink failed: " + std::string(std::strerror(errno)));
+            }
+            data += written;
+            size -= (size_t)written;
+            bytes_ += (size_t)written;
+        }
+    }
+
+    // Discards what was written so far, for a retried transfer. Impossible
+    // for a pipe that has already been written to.
+    bool rewind() {
+        if (bytes_ == 0) return true;
+        if (!owns_fd_) return false;
+        if (ftruncate(fd_, 0) != 0 || lseek(fd_, 0, SEEK_SET) != 0) return false;
+        bytes_ = 0;
+        return true;
+    }
+
+    // Makes the body visible at its final path (file mode).
+    void commit() {
+        if (!owns_fd_ || committed_) return;
+        if (fsync(fd_) != 0) {
+            throw std::runtime_error("fsync failed for " + temp_path_ + ": " + std::strerror(errno));
+        }
+        if (std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+            throw std::runtime_error("Cannot move response into " + path_ + ": " + std::strerror(errno));
+        }
+        committed_ = true;
+
+        // Persist the rename itself
+        size_t slash = path_.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path_.substr(0, slash);
+        int dir_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            ::close(dir_fd);
+        }
+    }
+
+    const std::string& path() const { return path_; }
+    size_t bytesWritten() const { return bytes_; }
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    bool committed_ = false;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+// When and how long to wait before retrying a request.
+//
+// - Only failures that can succeed on a second try are retried: transport
+//   errors that smell like a flaky network, 408, 429, 500, 502, 503, 504.
+//   Other 4xx answers are final.
+// - Backoff is "full jitter": a uniform random delay in [0, min(cap, base * 2^n)],
+//   so clients that failed together do not come back together.
+// - A Retry-After header (seconds or HTTP-date) on 429/503 replaces the
+//   computed delay; if the server asks for longer than max_retry_after we
+//   give up instead of parking the request.
+// - RetryBudget limits retries process-wide to a fraction of first attempts,
+//   so a provider brownout is not multiplied by our own retry traffic.
+
+#include <string>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
+#include <curl/curl.h>
+
+class RetryBudget {
+public:
+    // ratio: retry tokens earned per first attempt; max_tokens: burst allowance
+    explicit RetryBudget(double ratio = 0.1, double max_tokens = 10.0)
+        : ratio_(ratio), max_tokens_(max_tokens), tokens_(max_tokens) {}
+
+    // Shared by every request engine in the process.
+    static RetryBudget& process() {
+        static RetryBudget budget;
+        return budget;
+    }
+
+    void recordAttempt() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tokens_ = std::min(max_tokens_, tokens_ + ratio_);
+    }
+
+    bool tryWithdraw() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tokens_ < 1.0) return false;
+        tokens_ -= 1.0;
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    double ratio_;
+    double max_tokens_;
+    double tokens_;
+};
+
+struct RetryPolicy {
+    int max_attempts = 3;
+    std::chrono::milliseconds base_delay{500};
+    std::chrono::milliseconds max_delay{30000};
+    std::chrono::milliseconds max_retry_after{120000};
+
+    static bool isRetryableStatus(long status) {
+        return status == 408 || status == 429 || status == 500 ||
+               status == 502 || status == 503 || status == 504;
+    }
+
+    static bool isRetryableTransport(CURLcode code) {
+        switch (code) {
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_GOT_NOTHING:
+            case CURLE_PARTIAL_FILE:
+            case CURLE_HTTP2:
+            case CURLE_HTTP2_STREAM:
+            case CURLE_SSL_CONNECT_ERROR:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Full-jitter delay before attempt number `retry` (1 = first retry).
+    std::chrono::milliseconds backoff(int retry) const {
+        static thread_local std::mt19937_64 rng(std::random_device{}());
+        long long ceiling = base_delay.count();
+        for (int i = 1; i < retry && ceiling < max_delay.count(); ++i) ceiling *= 2;
+        ceiling = std::min<long long>(ceiling, max_delay.count());
+        std::uniform_int_distribution<long long> pick(0, ceiling);
+        return std::chrono::milliseconds(pick(rng));
+    }
+
+    // Parses a Retry-After value: delta-seconds or an HTTP-date.
+    // Returns a negative duration when the header is absent or unparseable.
+    static std::chrono::milliseconds parseRetryAfter(const std::string& value) {
+        if (value.empty()) return std::chrono::milliseconds(-1);
+        char* end = nullptr;
+        long seconds = std::strtol(value.c_str(), &end, 10);
+        if (end != value.c_str() && *end == '\0') {
+            return std::chrono::seconds(std::max(0L, seconds));
+        }
+        time_t when = curl_getdate(value.c_str(), nullptr);
+        if (when < 0) return std::chrono::milliseconds(-1);
+        return std::chrono::seconds(std::max<long long>(0, (long long)(when - std::time(nullptr))));
+    }
+
+    // Decides whether attempt number `attempt` (1-based, just finished) gets
+    // another try and how long to wait first. `retry_after` is the raw header
+    // value, if any. Consumes a token from the budget when it says yes.
+    bool shouldRetry(int attempt, long status, CURLcode transport, const std::string& retry_after,
+                     std::chrono::milliseconds& delay, RetryBudget& budget = RetryBudget::process()) const {
+        if (attempt >= max_attempts) return false;
+        bool retryable = transport != CURLE_OK ? isRetryableTransport(transport) : isRetryableStatus(status);
+        if (!retryable) return false;
+
+        delay = backoff(attempt);
+        if (status == 429 || status == 503) {
+            std::chrono::milliseconds asked = parseRetryAfter(retry_after);
+            if (asked > max_retry_after) return false;
+            if (asked.count() >= 0) delay = asked;
+        }
+        return budget.tryWithdraw();
+    }
+};
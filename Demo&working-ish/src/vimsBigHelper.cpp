@@ -1,33 +1,65 @@
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <algorithm> // For min
+#include <chrono>    // Timing cache lookups for --stats
+#include <optional>  // Cache lookups may miss
+#include <vector>
+#include <fstream>   // For --batch request files
+#include <memory>    // For unique_ptr
+#include <functional> // For the streaming delta callback
 #include <stdexcept> // For runtime_error
 #include <cstdlib>   // For getenv, exit
 #include <curl/curl.h> // For libcurl functions
 #include "json.hpp"   // For nlohmann/json
+#include "responseCache.hpp" // On-disk response cache
+#include "requestBatch.hpp"  // Concurrent requests on one curl multi handle
+#include "jsonPathExtractor.hpp" // Pulls the answer out of a reply without a DOM
+#include "requestMetrics.hpp"    // Per-request timings for --stats and API_METRICS_FILE
+#include "bodyCompression.hpp"   // --compress / API_COMPRESS for large prompts
 
 // Use nlohmann/json namespace
 using json = nlohmann::json;
 
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    // Append the new data to the string
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    // Return the number of bytes handled
-    return size * nmemb;
+// One easy handle lives for the whole process. curl_easy_reset() clears the
+// options between requests but keeps the connection cache, DNS cache and TLS
+// session IDs, so a long-running --serve process skips the handshake after
+// its first request.
+static CURL* acquireHandle() {
+    static std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> handle(nullptr, curl_easy_cleanup);
+    if (!handle) {
+        handle.reset(curl_easy_init());
+        if (!handle) {
+            throw std::runtime_error("Failed to initialize libcurl.");
+        }
+    } else {
+        curl_easy_reset(handle.get());
+    }
+    return handle.get();
 }
 
 
-std::string fetchAPIData(const std::string& endpoint_url, const std::string& prompt) {
-    // 1. Get API Key from environment variable
+static std::string getAPIKey() {
     const char* api_key_cstr = std::getenv("API_KEY");
     if (api_key_cstr == nullptr) {
         throw std::runtime_error("Error: API_KEY environment variable not set.");
     }
-    std::string api_key = api_key_cstr;
+    return api_key_cstr;
+}
 
-    // 2. Construct the full URL with the API key
-    std::string full_url = endpoint_url + "?key=" + api_key;
+// Compresses the payload when --compress (or API_COMPRESS) is on and it is
+// big enough, adding the Content-Encoding header. Returns what to post: the
+// payload itself, or `compressed`.
+static const std::string& postBody(const std::string& payload_str, std::string& compressed,
+                                   struct curl_slist*& headers) {
+    const RequestCompression& compression = RequestCompression::process();
+    if (!compression.appliesTo(payload_str.size())) return payload_str;
+    compressed = compression.compress(payload_str);
+    headers = curl_slist_append(headers, (std::string("Content-Encoding: ") + compression.contentEncoding()).c_str());
+    return compressed;
+}
 
-    // 3. Construct the Gemini-specific JSON payload
+static std::string buildGeminiPayload(const std::string& prompt) {
     json payload;
     payload["contents"] = json::array({
         {
@@ -36,35 +68,155 @@ std::string fetchAPIData(const std::string& endpoint_url, const std::string& pro
             })}
         }
     });
-    std::string payload_str = payload.dump(); // Serialize JSON to string
+    return payload.dump(); // Serialize JSON to string
+}
+
+// Concatenates the text of every part of the first candidate. Streamed chunks
+// may split one answer across several parts.
+static std::string candidateText(const json& response_json) {
+    std::string text;
+    for (const auto& part : response_json.at("candidates").at(0).at("content").at("parts")) {
+        text += part.value("text", "");
+    }
+    return text;
+}
+
+// Where the answer lives in a reply, as JSON pointers tried in order; the
+// first one present wins. Defaults to Gemini's first text part. Override with
+// --path (repeatable) or API_RESPONSE_PATH="/a/b,/c/d" for other APIs.
+static std::vector<std::string>& responsePaths() {
+    static std::vector<std::string> paths = [] {
+        std::vector<std::string> configured;
+        const char* env = std::getenv("API_RESPONSE_PATH");
+        std::string list = env ? env : "";
+        size_t start = 0;
+        while (start < list.size()) {
+            size_t comma = list.find(',', start);
+            if (comma == std::string::npos) comma = list.size();
+            if (comma > start) configured.push_back(list.substr(start, comma - start));
+            start = comma + 1;
+        }
+        if (configured.empty()) configured.push_back("/candidates/0/content/parts/0/text");
+        return configured;
+    }();
+    return paths;
+}
+
+// Response bodies are parsed as they arrive: the extractor sees every chunk
+// from the write callback and the body itself is only kept (up to a cap) so
+// an error reply can still be shown to the user.
+struct ExtractState {
+    JsonPathExtractor extractor{responsePaths()};
+    std::string head;       // First bytes of the body, for error messages
+    std::string error;      // Parse error, reported after the transfer
+    static constexpr size_t head_limit = 64 * 1024;
+};
+
+static size_t ExtractCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    ExtractState& state = *static_cast<ExtractState*>(userp);
+    size_t bytes = size * nmemb;
+    if (state.head.size() < ExtractState::head_limit) {
+        state.head.append((char*)contents, std::min(bytes, ExtractState::head_limit - state.head.size()));
+    }
+    if (state.error.empty()) {
+        try {
+            state.extractor.feed(std::string_view((char*)contents, bytes));
+        } catch (const std::exception& e) {
+            state.error = e.what(); // Keep reading; the status code may explain it
+        }
+    }
+    return bytes;
+}
+
+// The text at the first configured path that was present.
+static std::string extractedText(ExtractState& state) {
+    try {
+        if (state.error.empty()) state.extractor.finish();
+    } catch (const std::exception& e) {
+        state.error = e.what();
+    }
+    for (size_t i = 0; i < responsePaths().size(); ++i) {
+        if (state.extractor.found(i)) return state.extractor.value(i);
+    }
+    std::string reason = state.error.empty() ? "no value at " + responsePaths().front() : state.error;
+    throw std::runtime_error("Error: Could not parse API response.\nJSON Error: " + reason + "\nResponse: " + state.head);
+}
 
-    CURL* curl = nullptr;
+static ResponseCache& responseCache() {
+    static ResponseCache cache;
+    return cache;
+}
+
+// The API key is deliberately left out of the key: it authorizes the request
+// but does not change the answer.
+// Non-default response paths pick a different answer out of the same reply,
+// so they are part of the key.
+static ResponseCache::Key promptCacheKey(const std::string& endpoint_url, const std::string& payload_str) {
+    std::vector<std::pair<std::string, std::string>> headers = {{"Content-Type", "application/json"}};
+    const std::vector<std::string>& paths = responsePaths();
+    if (paths.size() != 1 || paths.front() != "/candidates/0/content/parts/0/text") {
+        std::string joined;
+        for (const auto& path : paths) joined += path + ",";
+        headers.emplace_back("Response-Path", joined);
+    }
+    return ResponseCache::makeKey(endpoint_url, "POST", headers, payload_str);
+}
+
+// Cache lookup that also counts the hit in the request metrics.
+static std::optional<std::string> cachedAnswer(const ResponseCache::Key& key, const std::string& endpoint_url) {
+    auto started = std::chrono::steady_clock::now();
+    std::optional<std::string> cached = responseCache().lookup(key);
+    if (cached) {
+        RequestMetrics::process().record(RequestSample::cacheHit(
+            endpoint_url, std::chrono::steady_clock::now() - started, cached->size()));
+    }
+    return cached;
+}
+
+std::string fetchAPIData(const std::string& endpoint_url, const std::string& prompt, bool use_cache = true) {
+    // 1. Get API Key from environment variable
+    std::string api_key = getAPIKey();
+
+    // 2. Construct the full URL with the API key
+    std::string full_url = endpoint_url + "?key=" + api_key;
+
+    // 3. Construct the Gemini-specific JSON payload
+    std::string payload_str = buildGeminiPayload(prompt);
+
+    // Same endpoint and payload as an earlier call: answer from disk
+    ResponseCache::Key cache_key = promptCacheKey(endpoint_url, payload_str);
+    if (use_cache) {
+        if (auto cached = cachedAnswer(cache_key, endpoint_url)) return *cached;
+    }
+
+    CURL* curl = acquireHandle(); // Reused between calls, see acquireHandle()
     CURLcode res;
-    std::string readBuffer; // String to store the response
+    ExtractState extract; // Parses the response while it downloads
     long http_code = 0;
     struct curl_slist* headers = nullptr;
 
     try {
-        curl = curl_easy_init(); // Initialize libcurl
-        if (!curl) {
-            throw std::runtime_error("Failed to initialize libcurl.");
-        }
-
         // 4. Prepare the POST request headers
         headers = curl_slist_append(headers, "Content-Type: application/json");
         if (!headers) {
             throw std::runtime_error("Failed to create curl headers.");
         }
+        std::string compressed;
+        const std::string& body = postBody(payload_str, compressed, headers);
 
         // Set libcurl options
         curl_easy_setopt(curl, CURLOPT_URL, full_url.c_str());
         curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload_str.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body.size());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // Compressed replies are decoded by curl
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ExtractCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &extract);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L); // Keep idle pooled connections alive
 
         // 5. Make the request
         res = curl_easy_perform(curl);
+        RequestMetrics::process().record(RequestSample::fromCurl(curl, endpoint_url, res));
         if (res != CURLE_OK) {
             throw std::runtime_error("curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)));
         }
@@ -72,45 +224,455 @@ std::string fetchAPIData(const std::string& endpoint_url, const std::string& pro
         // Get the HTTP response code
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
 
-        // Cleanup
+        // Cleanup (the handle itself stays alive for the next request)
         curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
+        headers = nullptr;
 
         // Check for HTTP errors
         if (http_code >= 400) {
-            throw std::runtime_error("HTTP Error: " + std::to_string(http_code) + "\n" + readBuffer);
+            throw std::runtime_error("HTTP Error: " + std::to_string(http_code) + "\n" + extract.head);
         }
 
-        // 6. Parse the Gemini-specific response
-        try {
-            json response_json = json::parse(readBuffer);
-            std::string text_output = response_json["candidates"][0]["content"]["parts"][0]["text"];
-            return text_output;
-        } catch (const json::exception& e) {
-            // Handle cases where the JSON response is not what we expect
-            throw std::runtime_error("Error: Could not parse API response.\nJSON Error: " + std::string(e.what()) + "\nResponse: " + readBuffer);
-        }
+        // 6. Pick the answer out of the (already parsed) response
+        std::string text_output = extractedText(extract);
+        if (use_cache) responseCache().store(cache_key, text_output);
+        return text_output;
 
     } catch (...) {
         // Ensure cleanup happens even if an exception is thrown
         if (headers) curl_slist_free_all(headers);
-        if (curl) curl_easy_cleanup(curl);
         throw; // Re-throw the caught exception
     }
 }
 
+// Incremental parser for the server-sent events streamGenerateContent emits
+// with alt=sse. Every "data:" event is a complete GenerateContentResponse that
+// carries the next slice of the answer, so each one is forwarded as soon as
+// its terminating blank line arrives.
+struct StreamState {
+    std::function<void(const std::string&)> on_delta;
+    std::string pending;    // Bytes not yet terminated by a newline
+    std::string event_data; // "data:" lines of the event being assembled
+    std::string full_text;  // Everything forwarded so far
+    std::string raw;        // Body kept while no event has been seen (error responses)
+    std::string error;      // First parse or callback error, reported after the transfer
+    bool saw_event = false;
+};
+
+static void dispatchStreamEvent(StreamState& state) {
+    if (state.event_data.empty()) return;
+    state.saw_event = true;
+    state.raw.clear();
+
+    json event = json::parse(state.event_data);
+    state.event_data.clear();
+    if (event.contains("error")) {
+        throw std::runtime_error("Error: API returned an error mid-stream: " + event["error"].dump());
+    }
+    std::string delta = candidateText(event);
+    if (delta.empty()) return;
+    state.full_text += delta;
+    if (state.on_delta) state.on_delta(delta);
+}
+
+static size_t StreamCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    StreamState& state = *static_cast<StreamState*>(userp);
+    size_t bytes = size * nmemb;
+    state.pending.append((char*)contents, bytes);
+    if (!state.saw_event) state.raw.append((char*)contents, bytes);
+
+    try {
+        size_t start = 0;
+        size_t newline;
+        while ((newline = state.pending.find('\n', start)) != std::string::npos) {
+            size_t end = newline;
+            if (end > start && state.pending[end - 1] == '\r') --end;
+            std::string_view line(state.pending.data() + start, end - start);
+            start = newline + 1;
+
+            if (line.empty()) {
+                dispatchStreamEvent(state);
+            } else if (line.substr(0, 5) == "data:") {
+                line.remove_prefix(5);
+                if (!line.empty() && line.front() == ' ') line.remove_prefix(1);
+                if (!state.event_data.empty()) state.event_data += '\n';
+                state.event_data.append(line.data(), line.size());
+            }
+            // "event:", "id:" and ":" comment lines carry nothing we need.
+        }
+        state.pending.erase(0, start);
+    } catch (const std::exception& e) {
+        // Never let an exception cross libcurl's C frames; abort the transfer instead.
+        state.error = e.what();
+        return 0;
+    }
+    return bytes;
+}
+
+// Streaming variant of fetchAPIData(). Calls streamGenerateContent and hands
+// every text delta to on_delta while the transfer is still running. Returns
+// the complete text once the stream ends.
+std::string streamAPIData(const std::string& endpoint_url, const std::string& prompt,
+                          const std::function<void(const std::string&)>& on_delta,
+                          bool use_cache = true) {
+    std::string api_key = getAPIKey();
+    std::string payload_str = buildGeminiPayload(prompt);
+
+    // Cached answers are shared with fetchAPIData() and arrive as one delta
+    ResponseCache::Key cache_key = promptCacheKey(endpoint_url, payload_str);
+    if (use_cache) {
+        if (auto cached = cachedAnswer(cache_key, endpoint_url)) {
+            if (on_delta) on_delta(*cached);
+            return *cached;
+        }
+    }
+
+    // Point a plain generateContent URL at its streaming sibling
+    std::string stream_url = endpoint_url;
+    const std::string unary = ":generateContent";
+    if (stream_url.size() >= unary.size() &&
+        stream_url.compare(stream_url.size() - unary.size(), unary.size(), unary) == 0) {
+        stream_url.replace(stream_url.size() - unary.size(), unary.size(), ":streamGenerateContent");
+    }
+    std::string full_url = stream_url + "?alt=sse&key=" + api_key;
+
+    CURL* curl = acquireHandle();
+    StreamState state;
+    state.on_delta = on_delta;
+    long http_code = 0;
+    struct curl_slist* headers = nullptr;
+
+    try {
+        headers = curl_slist_append(headers, "Content-Type: application/json");
+        headers = curl_slist_append(headers, "Accept: text/event-stream");
+        if (!headers) {
+            throw std::runtime_error("Failed to create curl headers.");
+        }
+        std::string compressed;
+        const std::string& body = postBody(payload_str, compressed, headers);
+
+        curl_easy_setopt(curl, CURLOPT_URL, full_url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body.size());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &state);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+
+        CURLcode res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        RequestMetrics::process().record(RequestSample::fromCurl(curl, stream_url, res));
+        curl_slist_free_all(headers);
+        headers = nullptr;
+
+        if (!state.error.empty()) {
+            throw std::runtime_error(state.error);
+        }
+        if (res != CURLE_OK) {
+            throw std::runtime_error("curl_easy_perform() failed: " + std::string(curl_easy_strerror(res)));
+        }
+        if (http_code >= 400) {
+            throw std::runtime_error("HTTP Error: " + std::to_string(http_code) + "\n" + state.raw);
+        }
+
+        // A final event without a trailing blank line is still an event
+        if (!state.pending.empty()) {
+            char newline[] = "\n";
+            StreamCallback(newline, 1, 1, &state);
+        }
+        dispatchStreamEvent(state);
+        if (!state.saw_event) {
+            throw std::runtime_error("Error: Could not parse API response.\nResponse: " + state.raw);
+        }
+        if (use_cache) responseCache().store(cache_key, state.full_text);
+        return state.full_text;
+    } catch (...) {
+        if (headers) curl_slist_free_all(headers);
+        throw;
+    }
+}
+
+struct BatchItem {
+    std::string endpoint;
+    std::string prompt;
+    std::string text;  // Filled on success
+    std::string error; // Filled on failure
+};
+
+// Batch variant of fetchAPIData(). Sends every uncached prompt concurrently,
+// at most max_concurrency at a time, multiplexed over HTTP/2 where the server
+// supports it. Each item gets either text or error; one failure does not
+// affect the others.
+void fetchAPIDataBatch(std::vector<BatchItem>& items, size_t max_concurrency, bool use_cache = true) {
+    std::string api_key = getAPIKey();
+
+    std::vector<BatchRequest> requests;
+    std::vector<size_t> owners;                 // requests[i] answers items[owners[i]]
+    std::vector<ResponseCache::Key> cache_keys; // Parallel to requests
+    std::vector<std::unique_ptr<ExtractState>> extracts; // Parallel to requests
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::string payload_str = buildGeminiPayload(items[i].prompt);
+        ResponseCache::Key cache_key = promptCacheKey(items[i].endpoint, payload_str);
+        if (use_cache) {
+            if (auto cached = cachedAnswer(cache_key, items[i].endpoint)) {
+                items[i].text = *cached;
+                continue;
+            }
+        }
+        BatchRequest request;
+        request.url = items[i].endpoint + "?key=" + api_key;
+        request.headers = {"Content-Type: application/json"};
+        request.body = std::move(payload_str);
+        request.compression = RequestCompression::process();
+        extracts.push_back(std::make_unique<ExtractState>());
+        ExtractState* extract = extracts.back().get();
+        request.on_data = [extract](const char* data, size_t size) {
+            ExtractCallback((void*)data, 1, size, extract);
+        };
+        requests.push_back(std::move(request));
+        owners.push_back(i);
+        cache_keys.push_back(cache_key);
+    }
+    if (requests.empty()) return;
+
+    // Warm connections survive between batches with the same concurrency cap
+    static std::unique_ptr<RequestBatch> batch;
+    static size_t batch_concurrency = 0;
+    if (!batch || batch_concurrency != max_concurrency) {
+        batch = std::make_unique<RequestBatch>(max_concurrency);
+        batch_concurrency = max_concurrency;
+    }
+    std::vector<BatchResult> results = batch->run(requests);
+
+    for (size_t r = 0; r < results.size(); ++r) {
+        BatchItem& item = items[owners[r]];
+        const BatchResult& result = results[r];
+        try {
+            if (!result.error.empty()) {
+                throw std::runtime_error(result.error);
+            }
+            if (result.status >= 400) {
+                throw std::runtime_error("HTTP Error: " + std::to_string(result.status) + "\n" + result.body);
+            }
+            item.text = extractedText(*extracts[r]);
+            if (use_cache) responseCache().store(cache_keys[r], item.text);
+        } catch (const std::exception& e) {
+            item.error = e.what();
+        }
+    }
+}
+
+// --batch: reads one request per line from requests_file, either a JSON
+// string (the prompt) or {"prompt": "...", "endpoint": "..."}, and prints one
+// JSON line per request in the same order: {"index": n, "text": "..."} or
+// {"index": n, "error": "..."}.
+int runBatchFile(const std::string& default_endpoint, const std::string& requests_file,
+                 size_t max_concurrency, bool use_cache) {
+    std::ifstream file(requests_file);
+    if (!file) {
+        throw std::runtime_error("Error: cannot open batch file: " + requests_file);
+    }
+
+    std::vector<BatchItem> items;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty()) continue;
+        json request = json::parse(line);
+        BatchItem item;
+        item.endpoint = default_endpoint;
+        if (request.is_string()) {
+            item.prompt = request.get<std::string>();
+        } else {
+            item.prompt = request.at("prompt").get<std::string>();
+            item.endpoint = request.value("endpoint", default_endpoint);
+        }
+        items.push_back(std::move(item));
+    }
+
+    fetchAPIDataBatch(items, max_concurrency, use_cache);
+
+    int failures = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        json out = {{"index", i}};
+        if (items[i].error.empty()) {
+            out["text"] = items[i].text;
+        } else {
+            out["error"] = items[i].error;
+            ++failures;
+        }
+        std::cout << out.dump() << '\n';
+    }
+    std::cout << std::flush;
+    return failures ? 1 : 0;
+}
+
+// Long-running mode for Vim's job_start()/ch_sendexpr(). Reads one JSON
+// message per line on stdin and answers each on its own line on stdout.
+//   Vim channel form: [id, {"prompt": "...", "endpoint": "..."}]  ->  [id, {"text": "..."}]
+//   Plain form:       {"id": 7, "prompt": "..."}                  ->  {"id": 7, "text": "..."}
+// With "stream": true, every text delta is pushed ahead of the final reply as
+//   Vim channel form: [0, {"tag": <request tag>, "delta": "..."}]  (goes to the channel callback)
+//   Plain form:       {"id": 7, "tag": <request tag>, "delta": "..."}
+// "cache": false skips the response cache for that one request.
+// {"command": "stats"} is answered with {"stats": {...}}, the aggregated
+// request metrics (see requestMetrics.hpp).
+// Failures are answered with an "error" field instead of "text" so one bad
+// request never takes the process down.
+int serveChannel(const std::string& default_endpoint, bool use_cache) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+
+        json id = nullptr;
+        bool vim_channel = false;
+        json body;
+        try {
+            json message = json::parse(line);
+            json request;
+            if (message.is_array()) {
+                vim_channel = true;
+                id = message.at(0);
+                request = message.at(1);
+            } else {
+                id = message.value("id", json(nullptr));
+                request = message;
+            }
+
+            if (request.value("command", std::string()) == "stats") {
+                // Metrics of every request this process has made so far
+                body["stats"] = json::parse(RequestMetrics::process().summaryJson());
+            } else {
+                std::string endpoint = request.value("endpoint", default_endpoint);
+                if (endpoint.empty()) {
+                    throw std::runtime_error("Error: no endpoint given and no default endpoint set.");
+                }
+                std::string prompt = request.at("prompt").get<std::string>();
+                bool cache = use_cache && request.value("cache", true);
+                if (request.value("stream", false)) {
+                    json tag = request.value("tag", json(nullptr));
+                    body["text"] = streamAPIData(endpoint, prompt, [&](const std::string& delta) {
+                        json note = {{"tag", tag}, {"delta", delta}};
+                        if (vim_channel) {
+                            note = json::array({0, note});
+                        } else {
+                            note["id"] = id;
+                        }
+                        std::cout << note.dump() << '\n' << std::flush;
+                    }, cache);
+                } else {
+                    body["text"] = fetchAPIData(endpoint, prompt, cache);
+                }
+            }
+        } catch (const std::exception& e) {
+            body["error"] = e.what();
+        }
+
+        json reply;
+        if (vim_channel) {
+            reply = json::array({id, body});
+        } else {
+            reply = body;
+            reply["id"] = id;
+        }
+        // Vim reads the channel line by line, so flush after every reply.
+        std::cout << reply.dump() << '\n' << std::flush;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    // Leading flags:
+    //   --serve     daemon mode, one process for many requests
+    //   --stream    print text as it arrives instead of after the whole reply
+    //   --no-cache  always go to the network
+    //   --batch     <endpoint_url> <requests_file>, requests run concurrently
+    //   --concurrency N   in-flight cap for --batch (default 8)
+    //   --path P    JSON pointer of the answer in the reply (repeatable, first match wins)
+    //   --stats     print request timing histograms (JSON) to stderr on exit
+    //   --metrics-file F   append one JSON line per request to F (default $API_METRICS_FILE)
+    //   --compress E  send large prompts compressed: gzip, zstd, "gzip:9"... (default $API_COMPRESS)
+    bool serve = false;
+    bool stream = false;
+    bool batch = false;
+    bool use_cache = true;
+    size_t concurrency = 8;
+    std::vector<std::string> paths;
+    bool stats = false;
+    int first_arg = 1;
+    for (; first_arg < argc && std::string(argv[first_arg]).rfind("--", 0) == 0; ++first_arg) {
+        std::string flag = argv[first_arg];
+        if (flag == "--serve") {
+            serve = true;
+        } else if (flag == "--stream") {
+            stream = true;
+        } else if (flag == "--no-cache") {
+            use_cache = false;
+        } else if (flag == "--batch") {
+            batch = true;
+        } else if (flag == "--concurrency" && first_arg + 1 < argc) {
+            concurrency = std::stoul(argv[++first_arg]);
+        } else if (flag == "--path" && first_arg + 1 < argc) {
+            paths.push_back(argv[++first_arg]);
+        } else if (flag == "--stats") {
+            stats = true;
+        } else if (flag == "--metrics-file" && first_arg + 1 < argc) {
+            RequestMetrics::process().setMetricsFile(argv[++first_arg]);
+        } else if (flag == "--compress" && first_arg + 1 < argc) {
+            try {
+                size_t min_bytes = RequestCompression::process().min_bytes;
+                RequestCompression::process() = RequestCompression::parse(argv[++first_arg]);
+                RequestCompression::process().min_bytes = min_bytes;
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option: " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    if (!paths.empty()) responsePaths() = paths;
+
+    // Whatever happens below, --stats reports what the requests did
+    struct StatsOnExit {
+        bool enabled;
+        ~StatsOnExit() {
+            if (enabled) std::cerr << json::parse(RequestMetrics::process().summaryJson()).dump(2) << std::endl;
+        }
+    } stats_on_exit{stats};
+
+    if (serve) {
+        return serveChannel(first_arg < argc ? argv[first_arg] : "", use_cache);
+    }
+
     // Check for the correct number of arguments
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <endpoint_url> <prompt>" << std::endl;
+    if (argc - first_arg != 2) {
+        std::cerr << "Usage: " << argv[0] << " [--stream] [--no-cache] [--stats] [--metrics-file F] [--compress E] [--path P]... <endpoint_url> <prompt>" << std::endl;
+        std::cerr << "       " << argv[0] << " --batch [--concurrency N] [--no-cache] [--stats] [--metrics-file F] [--compress E] [--path P]... <endpoint_url> <requests_file>" << std::endl;
+        std::cerr << "       " << argv[0] << " --serve [--no-cache] [--stats] [--metrics-file F] [--compress E] [--path P]... [default_endpoint_url]" << std::endl;
         return 1; // Use 1 for error exit status
     }
 
-    std::string endpoint = argv[1];
-    std::string prompt_text = argv[2];
+    std::string endpoint = argv[first_arg];
+    std::string prompt_text = argv[first_arg + 1];
 
     try {
-        std::string output = fetchAPIData(endpoint, prompt_text);
+        if (batch) {
+            return runBatchFile(endpoint, prompt_text, concurrency, use_cache);
+        }
+        if (stream) {
+            streamAPIData(endpoint, prompt_text, [](const std::string& delta) {
+                std::cout << delta << std::flush;
+            }, use_cache);
+            std::cout << std::endl;
+            return 0;
+        }
+        std::string output = fetchAPIData(endpoint, prompt_text, use_cache);
         std::cout << output << std::endl;
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
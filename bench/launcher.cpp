@@ -0,0 +1,62 @@
+// Process launcher for bench/run_bench.py.
+//
+// A child's peak RSS (ru_maxrss) includes whatever its parent had mapped when
+// it forked, so anything started straight from the Python harness reports at
+// least the interpreter's own ~10 MiB. This small process does the forking
+// instead. It reads one command per line on stdin, tab-separated, the first
+// field being the file to send the child's stdout to ("-" for /dev/null). It
+// runs the command and answers "<exit code> <peak RSS KiB> <wall us>".
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+int main() {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos) break;
+            start = tab + 1;
+        }
+        if (fields.size() < 2) {
+            std::cout << "127 0 0" << std::endl;
+            continue;
+        }
+
+        std::vector<char*> argv;
+        for (size_t i = 1; i < fields.size(); ++i) argv.push_back(&fields[i][0]);
+        argv.push_back(nullptr);
+
+        auto began = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            int devnull = open("/dev/null", O_RDWR);
+            int out = fields[0] == "-" ? devnull : open(fields[0].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            dup2(devnull, STDIN_FILENO);
+            dup2(out < 0 ? devnull : out, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            execvp(argv[0], argv.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        struct rusage usage {};
+        int code = 127;
+        if (pid > 0 && wait4(pid, &status, 0, &usage) == pid) {
+            code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        }
+        auto wall = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - began).count();
+        std::cout << code << ' ' << usage.ru_maxrss << ' ' << wall << std::endl;
+    }
+    return 0;
+}
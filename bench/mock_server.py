@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Gemini API (and a plain echo API) for benchmarks.
+
+Endpoints, matched on the path:
+  .../<model>:generateContent        Gemini-shaped JSON reply
+  .../<model>:streamGenerateContent  the same answer as server-sent events
+  /echo...                           sends the request body back unchanged
+  /status/<code>/...                 always answers <code> (after the latency)
+  GET /__stats                       request counters as JSON
+
+The answer text is "echo:<prompt>" padded to --payload-bytes. Every request
+waits --latency-ms (+ up to --jitter-ms) first, and --error-rate of them are
+answered 503 with Retry-After: 0 instead. With --port 0 a free port is picked;
+the first line on stdout is always "listening on http://127.0.0.1:<port>".
+
+Request bodies sent with Content-Encoding gzip or zstd are decoded first (zstd
+through the zstandard module or the zstd command, else 415). With
+--gzip-replies, answers go out gzip-compressed to clients that accept it.
+The byte counters in /__stats are bytes on the wire.
+"""
+
+import argparse
+import gzip
+import json
+import random
+import shutil
+import subprocess
+import sys
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+def decode_zstd(body):
+    try:
+        import zstandard
+        return zstandard.ZstdDecompressor().decompressobj().decompress(body)
+    except ImportError:
+        pass
+    if not shutil.which("zstd"):
+        raise ValueError("no zstd decoder available")
+    return subprocess.run(["zstd", "-dc"], input=body, stdout=subprocess.PIPE, check=True).stdout
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.errors = 0
+        self.bytes_in = 0
+        self.bytes_out = 0
+
+    def snapshot(self):
+        with self.lock:
+            return {"requests": self.requests, "errors": self.errors,
+                    "bytes_in": self.bytes_in, "bytes_out": self.bytes_out}
+
+
+def make_handler(options, stats):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"  # Keep-alive, like the real API
+        disable_nagle_algorithm = True  # Headers and body go out as separate writes
+
+        def log_message(self, fmt, *args):
+            if options.verbose:
+                sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+        def read_body(self):
+            if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+                body = b""
+                while True:
+                    size = int(self.rfile.readline().strip() or b"0", 16)
+                    if size == 0:
+                        self.rfile.readline()
+                        return body
+                    body += self.rfile.read(size)
+                    self.rfile.readline()
+            return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+        def decode_body(self, body):
+            """Undoes Content-Encoding; None (after answering 415) if it can't."""
+            encoding = self.headers.get("Content-Encoding", "identity").lower()
+            try:
+                if encoding == "gzip":
+                    return gzip.decompress(body)
+                if encoding == "zstd":
+                    return decode_zstd(body)
+                if encoding == "identity":
+                    return body
+            except (OSError, ValueError, subprocess.CalledProcessError):
+                pass
+            self.reply(415, b'{"error": {"code": 415, "status": "UNSUPPORTED_ENCODING"}}')
+            return None
+
+        def wants_gzip(self):
+            return options.gzip_replies and "gzip" in self.headers.get("Accept-Encoding", "")
+
+        def reply(self, status, body, content_type="application/json", extra=None):
+            if self.wants_gzip():
+                body = gzip.compress(body, 6)
+                extra = dict(extra or {}, **{"Content-Encoding": "gzip"})
+            self.send_response(status)
+            self.send_header("Content-Type", content_type)
+            self.send_header("Content-Length", str(len(body)))
+            for name, value in (extra or {}).items():
+                self.send_header(name, value)
+            self.end_headers()
+            self.wfile.write(body)
+            with stats.lock:
+                stats.bytes_out += len(body)
+                if status >= 400:
+                    stats.errors += 1
+
+        def answer_text(self, body):
+            try:
+                prompt = json.loads(body)["contents"][0]["parts"][0]["text"]
+            except (ValueError, KeyError, IndexError, TypeError):
+                prompt = body.decode("utf-8", "replace")
+            text = "echo:" + prompt
+            if len(text) < options.payload_bytes:
+                text += "x" * (options.payload_bytes - len(text))
+            return text
+
+        def handle_any(self):
+            body = self.read_body()
+            with stats.lock:
+                stats.requests += 1
+                stats.bytes_in += len(body)
+            body = self.decode_body(body)
+            if body is None:
+                return
+
+            path = self.path.split("?", 1)[0]
+            if path == "/__stats":
+                self.reply(200, json.dumps(stats.snapshot()).encode())
+                return
+
+            delay = options.latency_ms + random.uniform(0, options.jitter_ms)
+            if delay > 0:
+                time.sleep(delay / 1000.0)
+
+            if path.startswith("/status/"):
+                code = int(path.split("/")[2])
+                self.reply(code, b'{"error": {"code": %d}}' % code)
+                return
+            if random.random() < options.error_rate:
+                self.reply(503, b'{"error": {"code": 503, "status": "UNAVAILABLE"}}',
+                           extra={"Retry-After": "0"})
+                return
+            if path.startswith("/echo"):
+                self.reply(200, body, self.headers.get("Content-Type", "application/octet-stream"))
+                return
+
+            text = self.answer_text(body)
+            if path.endswith(":streamGenerateContent"):
+                self.stream(text)
+                return
+            out = json.dumps({"candidates": [{"content": {"parts": [{"text": text}], "role": "model"},
+                                              "finishReason": "STOP"}]}).encode()
+            self.reply(200, out)
+
+        def stream(self, text):
+            self.send_response(200)
+            self.send_header("Content-Type", "text/event-stream")
+            self.send_header("Transfer-Encoding", "chunked")
+            compressor = zlib.compressobj(6, zlib.DEFLATED, 31) if self.wants_gzip() else None
+            if compressor:
+                self.send_header("Content-Encoding", "gzip")
+            self.end_headers()
+            chunks = max(1, options.stream_chunks)
+            step = max(1, -(-len(text) // chunks))
+            for start in range(0, len(text), step):
+                event = {"candidates": [{"content": {"parts": [{"text": text[start:start + step]}]}}]}
+                data = ("data: " + json.dumps(event) + "\r\n\r\n").encode()
+                if compressor:  # Flushed per event so the client can show it right away
+                    data = compressor.compress(data) + compressor.flush(zlib.Z_SYNC_FLUSH)
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(data), data))
+                self.wfile.flush()
+                with stats.lock:
+                    stats.bytes_out += len(data)
+                if options.chunk_delay_ms > 0:
+                    time.sleep(options.chunk_delay_ms / 1000.0)
+            if compressor:
+                tail = compressor.flush()
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(tail), tail))
+            self.wfile.write(b"0\r\n\r\n")
+
+        do_GET = do_POST = do_PUT = do_DELETE = handle_any
+
+    return Handler
+
+
+class Server(ThreadingHTTPServer):
+    daemon_threads = True
+    request_queue_size = 128  # Batches open many connections at once
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=18080)
+    parser.add_argument("--latency-ms", type=float, default=0.0, help="delay before every answer")
+    parser.add_argument("--jitter-ms", type=float, default=0.0, help="extra uniform random delay")
+    parser.add_argument("--payload-bytes", type=int, default=0, help="minimum answer text length")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="fraction answered 503")
+    parser.add_argument("--stream-chunks", type=int, default=4, help="SSE events per streamed answer")
+    parser.add_argument("--chunk-delay-ms", type=float, default=0.0, help="delay between SSE events")
+    parser.add_argument("--gzip-replies", action="store_true", help="gzip answers for clients that accept it")
+    parser.add_argument("--verbose", action="store_true", help="log every request to stderr")
+    options = parser.parse_args()
+
+    server = Server(("127.0.0.1", options.port), make_handler(options, Stats()))
+    print("listening on http://127.0.0.1:%d" % server.server_address[1], flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
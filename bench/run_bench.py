@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""Benchmarks the built binaries against bench/mock_server.py.
+
+For every binary found in --build-dir and every mode it supports, sends
+--requests prompts and reports p50/p99 latency, throughput and peak RSS:
+
+  vimsBigHelper  oneshot   one process per prompt (what Vim's system() does)
+                 cached    same, with the response cache warm
+                 stream    one process per prompt with --stream
+                 serve     one --serve process, prompts sent one after another
+                 batch     one --batch process for all prompts; latency is the
+                           whole run, so p50/p99 are left blank
+  Vim_configs    oneshot   one process per request file
+  api_overlord   oneshot   one process per request file
+
+Peak RSS is the largest maximum resident set of any process in the run.
+One-shot processes are started through bench_launcher (built next to the
+binaries) so the harness's own memory does not leak into their ru_maxrss;
+without it the numbers are floored at the interpreter's size. The daemon's
+peak is read from /proc while it is still running. Nothing here needs
+network access or a real API key.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+GENERATE = "/v1beta/models/bench:generateContent"
+
+
+def percentile(samples, fraction):
+    """Nearest-rank percentile; None for no samples."""
+    if not samples:
+        return None
+    ordered = sorted(samples)
+    rank = max(1, int(-(-fraction * len(ordered) // 1)))
+    return ordered[min(rank, len(ordered)) - 1]
+
+
+class MockServer:
+    def __init__(self, args):
+        command = [sys.executable, os.path.join(HERE, "mock_server.py"), "--port", "0",
+                   "--latency-ms", str(args.latency_ms), "--jitter-ms", str(args.jitter_ms),
+                   "--payload-bytes", str(args.payload_bytes), "--error-rate", str(args.error_rate)]
+        if args.gzip_replies:
+            command.append("--gzip-replies")
+        self.process = subprocess.Popen(command, stdout=subprocess.PIPE, text=True)
+        line = self.process.stdout.readline().strip()
+        if not line.startswith("listening on "):
+            self.process.kill()
+            raise RuntimeError("mock server did not start: %r" % line)
+        self.url = line[len("listening on "):]
+
+    def close(self):
+        self.process.terminate()
+        self.process.wait()
+
+
+class Launcher:
+    """Runs commands to completion; run() returns (seconds, ok, peak RSS KiB)."""
+
+    def __init__(self, build_dir, env):
+        self.env = env
+        path = os.path.join(build_dir, "bench_launcher")
+        self.process = None
+        if os.access(path, os.X_OK):
+            self.process = subprocess.Popen([path], env=env, text=True,
+                                            stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+
+    def run(self, command, stdout_path=None):
+        if self.process:
+            self.process.stdin.write("\t".join([stdout_path or "-"] + command) + "\n")
+            self.process.stdin.flush()
+            code, rss, micros = (int(x) for x in self.process.stdout.readline().split())
+            return micros / 1e6, code == 0, rss
+        start = time.perf_counter()
+        with open(stdout_path or os.devnull, "w") as out:
+            process = subprocess.Popen(command, env=self.env, stdout=out, stderr=subprocess.DEVNULL)
+            _, status, usage = os.wait4(process.pid, 0)
+        process.returncode = os.waitstatus_to_exitcode(status)
+        return time.perf_counter() - start, process.returncode == 0, usage.ru_maxrss
+
+    def close(self):
+        if self.process:
+            self.process.stdin.close()
+            self.process.wait()
+
+
+def peak_rss_of_running(pid):
+    """VmHWM of a live process in KiB (0 if unavailable)."""
+    try:
+        with open("/proc/%d/status" % pid) as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return 0
+
+
+class Result:
+    def __init__(self, binary, mode):
+        self.binary = binary
+        self.mode = mode
+        self.latencies = []  # Seconds per request, when measurable
+        self.requests = 0
+        self.errors = 0
+        self.elapsed = 0.0
+        self.peak_rss = 0    # KiB
+
+    def add(self, seconds, ok, rss):
+        self.latencies.append(seconds)
+        self.requests += 1
+        self.errors += 0 if ok else 1
+        self.elapsed += seconds
+        self.peak_rss = max(self.peak_rss, rss)
+
+    def as_dict(self):
+        p50 = percentile(self.latencies, 0.50)
+        p99 = percentile(self.latencies, 0.99)
+        return {
+            "binary": self.binary,
+            "mode": self.mode,
+            "requests": self.requests,
+            "errors": self.errors,
+            "p50_ms": round(p50 * 1000, 2) if p50 is not None else None,
+            "p99_ms": round(p99 * 1000, 2) if p99 is not None else None,
+            "throughput_rps": round(self.requests / self.elapsed, 2) if self.elapsed else None,
+            "peak_rss_kib": self.peak_rss,
+        }
+
+
+def prompt(args, i):
+    return "bench prompt %d " % i + "p" * max(0, args.prompt_bytes - 16)
+
+
+def bench_helper_oneshot(launcher, binary, args, url, mode):
+    result = Result("vimsBigHelper", mode)
+    flags = ["--stream"] if mode == "stream" else []
+    if mode == "cached":
+        flags = []
+        launcher.run([binary, url + GENERATE, prompt(args, 0)])  # Warm the cache
+    else:
+        flags.append("--no-cache")
+    for i in range(args.requests):
+        text = prompt(args, 0 if mode == "cached" else i)
+        result.add(*launcher.run([binary] + flags + [url + GENERATE, text]))
+    return result
+
+
+def bench_helper_serve(binary, args, env, url):
+    result = Result("vimsBigHelper", "serve")
+    process = subprocess.Popen([binary, "--serve", "--no-cache", url + GENERATE], env=env, text=True,
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL)
+    for i in range(args.requests):
+        start = time.perf_counter()
+        process.stdin.write(json.dumps({"id": i, "prompt": prompt(args, i)}) + "\n")
+        process.stdin.flush()
+        reply = json.loads(process.stdout.readline() or "{}")
+        result.add(time.perf_counter() - start, "text" in reply, 0)
+    result.peak_rss = peak_rss_of_running(process.pid)
+    process.stdin.close()
+    process.wait()
+    return result
+
+
+def bench_helper_batch(launcher, binary, args, url, workdir):
+    result = Result("vimsBigHelper", "batch")
+    requests_file = os.path.join(workdir, "batch.jsonl")
+    with open(requests_file, "w") as f:
+        for i in range(args.requests):
+            f.write(json.dumps(prompt(args, i)) + "\n")
+    output_file = os.path.join(workdir, "batch.out")
+    result.elapsed, _, rss = launcher.run([binary, "--batch", "--no-cache", "--concurrency", str(args.concurrency),
+                                           url + GENERATE, requests_file], output_file)
+    with open(output_file) as f:
+        output = f.read()
+    for line in output.splitlines():
+        result.requests += 1
+        result.errors += 0 if "text" in json.loads(line) else 1
+    result.errors += max(0, args.requests - result.requests)
+    result.requests = args.requests
+    result.peak_rss = rss
+    return result
+
+
+def write_request_files(args, workdir):
+    paths = []
+    for i in range(args.requests):
+        path = os.path.join(workdir, "request%d.json" % i)
+        with open(path, "w") as f:
+            json.dump({"contents": [{"parts": [{"text": prompt(args, i)}]}]}, f)
+        paths.append(path)
+    return paths
+
+
+def bench_file_binary(launcher, name, command_for, args, workdir):
+    result = Result(name, "oneshot")
+    for i, path in enumerate(write_request_files(args, workdir)):
+        out = os.path.join(workdir, "%s.out%d.json" % (name, i))
+        result.add(*launcher.run(command_for(path, out)))
+    return result
+
+
+def print_table(rows):
+    header = ["binary", "mode", "requests", "errors", "p50 ms", "p99 ms", "req/s", "peak RSS MiB"]
+    table = [header]
+    for row in rows:
+        table.append([row["binary"], row["mode"], str(row["requests"]), str(row["errors"]),
+                      "-" if row["p50_ms"] is None else "%.2f" % row["p50_ms"],
+                      "-" if row["p99_ms"] is None else "%.2f" % row["p99_ms"],
+                      "-" if row["throughput_rps"] is None else "%.1f" % row["throughput_rps"],
+                      "%.1f" % (row["peak_rss_kib"] / 1024.0)])
+    widths = [max(len(r[c]) for r in table) for c in range(len(header))]
+    for r in table:
+        print("  ".join(cell.ljust(widths[c]) if c < 2 else cell.rjust(widths[c]) for c, cell in enumerate(r)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build-dir", default="build", help="where the binaries were built")
+    parser.add_argument("--requests", type=int, default=50, help="prompts per binary and mode")
+    parser.add_argument("--concurrency", type=int, default=8, help="in-flight cap for batch mode")
+    parser.add_argument("--latency-ms", type=float, default=20.0, help="mock server latency")
+    parser.add_argument("--jitter-ms", type=float, default=5.0, help="mock server latency jitter")
+    parser.add_argument("--payload-bytes", type=int, default=2048, help="answer size")
+    parser.add_argument("--prompt-bytes", type=int, default=256, help="prompt size")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="fraction of 503 answers")
+    parser.add_argument("--modes", default="oneshot,cached,stream,serve,batch",
+                        help="comma-separated vimsBigHelper modes to run")
+    parser.add_argument("--compress", metavar="ENCODING", default="",
+                        help="send request bodies compressed (API_COMPRESS): gzip, zstd, gzip:9, ...")
+    parser.add_argument("--gzip-replies", action="store_true", help="have the mock server gzip its answers")
+    parser.add_argument("--json", metavar="FILE", help="also write one JSON object per result line")
+    args = parser.parse_args()
+
+    build_dir = os.path.abspath(args.build_dir)
+    binaries = {name: os.path.join(build_dir, name) for name in ("vimsBigHelper", "Vim_configs", "api_overlord")}
+    binaries = {name: path for name, path in binaries.items() if os.access(path, os.X_OK)}
+    if not binaries:
+        sys.exit("no binaries found in %s; build first" % build_dir)
+
+    workdir = tempfile.mkdtemp(prefix="vim-api-bench.")
+    env = dict(os.environ, API_KEY="bench", API_CACHE_DIR=os.path.join(workdir, "cache"), TMPDIR=workdir)
+    if args.compress:
+        env["API_COMPRESS"] = args.compress
+    server = MockServer(args)
+    launcher = Launcher(build_dir, env)
+    print("mock server %s: latency %.0f±%.0f ms, %d byte answers, %.0f%% errors, %d requests per mode\n" %
+          (server.url, args.latency_ms, args.jitter_ms, args.payload_bytes, args.error_rate * 100, args.requests))
+
+    results = []
+    try:
+        helper = binaries.get("vimsBigHelper")
+        modes = [m for m in args.modes.split(",") if m]
+        for mode in modes if helper else []:
+            if mode in ("oneshot", "cached", "stream"):
+                results.append(bench_helper_oneshot(launcher, helper, args, server.url, mode))
+            elif mode == "serve":
+                results.append(bench_helper_serve(helper, args, env, server.url))
+            elif mode == "batch":
+                results.append(bench_helper_batch(launcher, helper, args, server.url, workdir))
+            else:
+                sys.exit("unknown mode: " + mode)
+        if "Vim_configs" in binaries:
+            results.append(bench_file_binary(launcher, "Vim_configs",
+                lambda path, out: [binaries["Vim_configs"], server.url + "/echo", path, "none", "", out],
+                args, workdir))
+        if "api_overlord" in binaries:
+            results.append(bench_file_binary(launcher, "api_overlord",
+                lambda path, out: [binaries["api_overlord"], "--no-cache", server.url + "/echo", path, "POST",
+                                   "default", out],
+                args, workdir))
+    finally:
+        launcher.close()
+        server.close()
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    rows = [r.as_dict() for r in results]
+    print_table(rows)
+    if args.json:
+        with open(args.json, "a") as f:
+            for row in rows:
+                f.write(json.dumps(row) + "\n")
+
+
+if __name__ == "__main__":
+    main()
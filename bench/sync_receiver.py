@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""Reference receiver for incremental buffer uploads (bufferSync.hpp).
+
+Any POST or PUT is answered by echoing back the buffer it carried, like
+mock_server.py's /echo, so Vim_configs --sync can be pointed straight at it.
+What makes it a receiver:
+
+  * A request with "X-Buffer-Sync: 1" has its (decoded) body kept, keyed by
+    SHA-256, and the answer says "X-Buffer-Sync: stored=<sha256>".
+  * A body of type application/x-buffer-delta is rebuilt first: one JSON
+    line {"base", "target", "size", "content_type", "ops"} followed by the
+    literal bytes. ["c", offset, length] copies from the stored base,
+    ["l", length] takes the next literal bytes. An unknown base is answered
+    409, a result that does not hash to "target" 422, and in both cases the
+    client falls back to sending the whole buffer.
+
+Kept buffers are evicted least recently used beyond --max-bytes. With
+--no-delta the server behaves like one that has never heard of any of this
+(deltas get 415, the header is ignored), for testing the fallback. GET
+/__stats returns counters; the first stdout line is "listening on <url>".
+"""
+
+import argparse
+import collections
+import gzip
+import hashlib
+import json
+import os
+import sys
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from mock_server import decode_zstd  # noqa: E402
+
+DELTA_TYPE = "application/x-buffer-delta"
+
+
+class Store:
+    """Buffers by SHA-256, least recently used first out."""
+
+    def __init__(self, max_bytes):
+        self.lock = threading.Lock()
+        self.max_bytes = max_bytes
+        self.bytes = 0
+        self.buffers = collections.OrderedDict()
+        self.stats = collections.Counter()
+
+    def put(self, data):
+        digest = hashlib.sha256(data).hexdigest()
+        with self.lock:
+            if digest in self.buffers:
+                self.buffers.move_to_end(digest)
+                return digest
+            self.buffers[digest] = data
+            self.bytes += len(data)
+            while self.bytes > self.max_bytes and len(self.buffers) > 1:
+                _, evicted = self.buffers.popitem(last=False)
+                self.bytes -= len(evicted)
+        return digest
+
+    def get(self, digest):
+        with self.lock:
+            data = self.buffers.get(digest)
+            if data is not None:
+                self.buffers.move_to_end(digest)
+            return data
+
+    def count(self, **increments):
+        with self.lock:
+            self.stats.update(increments)
+
+
+class DeltaError(Exception):
+    def __init__(self, status, message):
+        super().__init__(message)
+        self.status = status
+
+
+def apply_delta(body, store):
+    """Returns (content_type, rebuilt buffer) or raises DeltaError."""
+    newline = body.find(b"\n")
+    try:
+        manifest = json.loads(body[:newline])
+        base_hash, target, ops = manifest["base"], manifest["target"], manifest["ops"]
+    except (ValueError, KeyError, TypeError):
+        raise DeltaError(400, "malformed delta manifest")
+    base = store.get(base_hash)
+    if base is None:
+        raise DeltaError(409, "unknown base " + base_hash)
+
+    literals = memoryview(body)[newline + 1:]
+    parts = []
+    used = 0
+    for op in ops:
+        if op[0] == "c":
+            offset, length = op[1], op[2]
+            if offset + length > len(base):
+                raise DeltaError(400, "copy past the end of the base")
+            parts.append(base[offset:offset + length])
+        else:
+            length = op[1]
+            parts.append(bytes(literals[used:used + length]))
+            used += length
+    rebuilt = b"".join(parts)
+    if len(rebuilt) != manifest.get("size", len(rebuilt)) or hashlib.sha256(rebuilt).hexdigest() != target:
+        raise DeltaError(422, "rebuilt buffer does not match its hash")
+    return manifest.get("content_type", "application/octet-stream"), rebuilt
+
+
+def make_handler(options, store):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+        disable_nagle_algorithm = True
+
+        def log_message(self, fmt, *args):
+            if options.verbose:
+                sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+        def read_body(self):
+            if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+                body = b""
+                while True:
+                    size = int(self.rfile.readline().strip() or b"0", 16)
+                    if size == 0:
+                        self.rfile.readline()
+                        break
+                    body += self.rfile.read(size)
+                    self.rfile.readline()
+            else:
+                body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            encoding = self.headers.get("Content-Encoding", "identity").lower()
+            if encoding == "gzip":
+                return gzip.decompress(body)
+            if encoding == "zstd":
+                return decode_zstd(body)
+            return body
+
+        def reply(self, status, body, content_type="application/json", extra=None):
+            self.send_response(status)
+            self.send_header("Content-Type", content_type)
+            self.send_header("Content-Length", str(len(body)))
+            for name, value in (extra or {}).items():
+                self.send_header(name, value)
+            self.end_headers()
+            self.wfile.write(body)
+
+        def do_GET(self):
+            if self.path.split("?", 1)[0] == "/__stats":
+                with store.lock:
+                    snapshot = dict(store.stats, stored_buffers=len(store.buffers), stored_bytes=store.bytes)
+                self.reply(200, json.dumps(snapshot).encode())
+            else:
+                self.reply(404, b'{"error": "not found"}')
+
+        def do_POST(self):
+            wire = int(self.headers.get("Content-Length", 0) or 0)
+            body = self.read_body()
+            content_type = self.headers.get("Content-Type", "application/octet-stream")
+            syncing = not options.no_delta and self.headers.get("X-Buffer-Sync", "").strip() == "1"
+
+            if content_type.split(";")[0].strip() == DELTA_TYPE:
+                if options.no_delta:
+                    store.count(rejected=1)
+                    self.reply(415, b'{"error": "unsupported media type"}')
+                    return
+                try:
+                    content_type, body = apply_delta(body, store)
+                except DeltaError as e:
+                    store.count(rejected=1)
+                    self.reply(e.status, json.dumps({"error": str(e)}).encode())
+                    return
+                store.count(deltas=1, delta_bytes=wire or len(body))
+            else:
+                store.count(full_uploads=1, full_bytes=wire or len(body))
+
+            extra = {}
+            if syncing:
+                extra["X-Buffer-Sync"] = "stored=" + store.put(body)
+            self.reply(200, body, content_type, extra)
+
+        do_PUT = do_POST
+
+    return Handler
+
+
+class Server(ThreadingHTTPServer):
+    daemon_threads = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=18081)
+    parser.add_argument("--max-bytes", type=int, default=256 << 20, help="memory for kept buffers")
+    parser.add_argument("--no-delta", action="store_true", help="act like a server without delta support")
+    parser.add_argument("--verbose", action="store_true", help="log every request to stderr")
+    options = parser.parse_args()
+
+    server = Server(("127.0.0.1", options.port), make_handler(options, Store(options.max_bytes)))
+    print("listening on http://127.0.0.1:%d" % server.server_address[1], flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()